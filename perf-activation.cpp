@@ -0,0 +1,111 @@
+
+#include "perf-activation.hpp"
+#include <QDateTime>
+#include <util/platform.h>
+
+/* Activations kept for the report */
+#define MAX_ACTIVATION_RECORDS 200
+/* Sources that render nothing for this long are recorded without a first frame */
+#define ACTIVATION_TIMEOUT 30000000000ULL
+
+PerfActivationTracker::PerfActivationTracker(QObject *parent) : PerfFrameTracker(parent), records(MAX_ACTIVATION_RECORDS)
+{
+	signal_handler_connect(obs_get_signal_handler(), "source_activate", source_activate, this);
+	startSampling();
+}
+
+PerfActivationTracker::~PerfActivationTracker()
+{
+	signal_handler_disconnect(obs_get_signal_handler(), "source_activate", source_activate, this);
+	stopSampling();
+	for (auto &warmup : pending)
+		obs_weak_source_release(warmup.source);
+	for (auto &warmup : warming)
+		obs_weak_source_release(warmup.source);
+}
+
+void PerfActivationTracker::source_activate(void *data, calldata_t *cd)
+{
+	auto tracker = static_cast<PerfActivationTracker *>(data);
+	obs_source_t *source = static_cast<obs_source_t *>(calldata_ptr(cd, "source"));
+	if ((obs_source_get_output_flags(source) & OBS_SOURCE_ASYNC_VIDEO) != OBS_SOURCE_ASYNC_VIDEO)
+		return;
+	Warmup warmup;
+	warmup.source = obs_source_get_weak_source(source);
+	warmup.record.name = QString::fromUtf8(obs_source_get_name(source));
+	warmup.record.type = QString::fromUtf8(obs_source_get_display_name(obs_source_get_unversioned_id(source)));
+	warmup.record.time = QDateTime::currentMSecsSinceEpoch();
+	warmup.start_ns = os_gettime_ns();
+	QMutexLocker locker(&tracker->pendingMutex);
+	tracker->pending.append(warmup);
+}
+
+void PerfActivationTracker::sampleFrame()
+{
+	{
+		QMutexLocker locker(&pendingMutex);
+		warming.append(pending);
+		pending.clear();
+	}
+	if (warming.isEmpty())
+		return;
+
+	uint64_t now = os_gettime_ns();
+	for (auto i = warming.count() - 1; i >= 0; i--) {
+		auto &warmup = warming[i];
+		obs_source_t *source = obs_weak_source_get_source(warmup.source);
+		profiler_result_t perf;
+		if (!source || !obs_source_active(source) || !source_profiler_fill_result(source, &perf)) {
+			// Deactivated or removed before its first frame
+			obs_source_release(source);
+			obs_weak_source_release(warmup.source);
+			warming.removeAt(i);
+			continue;
+		}
+		obs_source_release(source);
+
+		warmup.record.cost.add(perf.tick_avg, perf.tick_max, perf);
+		if (perf.async_rendered > 0.0) {
+			warmup.record.latency = now - warmup.start_ns;
+			finish(warmup);
+			warming.removeAt(i);
+		} else if (now - warmup.start_ns > ACTIVATION_TIMEOUT) {
+			finish(warmup);
+			warming.removeAt(i);
+		}
+	}
+}
+
+void PerfActivationTracker::finish(Warmup &warmup)
+{
+	obs_weak_source_release(warmup.source);
+	warmup.source = nullptr;
+	auto record = warmup.record;
+	post([this, record] {
+		records.append(record);
+		if (record.latency) {
+			auto &latency = latencies[record.name];
+			latency.first += record.latency;
+			latency.second++;
+		}
+	});
+}
+
+QList<QStringList> PerfActivationTracker::results() const
+{
+	QList<QStringList> rows;
+	const auto &list = records.list();
+	for (auto i = list.count() - 1; i >= 0; i--) {
+		const auto &record = list.at(i);
+		auto latency = latencies.value(record.name);
+		rows.append(QStringList{
+			QDateTime::fromMSecsSinceEpoch(record.time).toString("HH:mm:ss.zzz"), record.name, record.type,
+			record.latency ? QString::asprintf("%.0f", (double)record.latency / 1000000.0)
+				       : QString::fromUtf8(obs_module_text("PerfViewer.NoFirstFrame")),
+			latency.second ? QString::asprintf("%.0f", (double)latency.first / (double)latency.second / 1000000.0)
+				       : QString(),
+			QString::number(record.cost.frames), QString::asprintf("%.02f", (double)record.cost.mean() / 1000000.0),
+			QString::asprintf("%.02f", (double)record.cost.peak / 1000000.0)});
+	}
+	return rows;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "obs-module.h"
+#include "perf-frame.hpp"
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+
+/* Time from activation to the first rendered async frame, and the cost until then */
+struct ActivationRecord {
+	QString name;
+	QString type;
+	qint64 time = 0;
+	/* 0 when no frame was rendered before the timeout */
+	uint64_t latency = 0;
+	/* While warming up */
+	PerfFrameCost cost;
+};
+
+/* Watches async sources every frame from activation until they render their first frame */
+class PerfActivationTracker : public PerfFrameTracker {
+	Q_OBJECT
+
+	struct Warmup {
+		obs_weak_source_t *source;
+		ActivationRecord record;
+		uint64_t start_ns;
+	};
+
+	/* Handed over by the activate signal, which can fire on any thread */
+	QMutex pendingMutex;
+	QList<Warmup> pending;
+	/* Only touched on the graphics thread */
+	QList<Warmup> warming;
+
+	PerfRecordRing<ActivationRecord> records;
+	/* Sum and count of measured latencies per source name, in ns */
+	QHash<QString, QPair<uint64_t, uint64_t>> latencies;
+
+	void finish(Warmup &warmup);
+
+	static void source_activate(void *data, calldata_t *cd);
+
+protected:
+	void sampleFrame() override;
+
+public:
+	PerfActivationTracker(QObject *parent = nullptr);
+	~PerfActivationTracker() override;
+
+	QList<QStringList> results() const;
+};
@@ -0,0 +1,232 @@
+
+#include "perf-advisor.hpp"
+#include "source-profiler.hpp"
+#include <QHash>
+#include <algorithm>
+
+/* Source area against the canvas area before scaling down is worth mentioning */
+#define ADVISOR_OVERSIZE 2.0
+/* Combined cost of one type's instances, as part of the frame interval, before they are worth consolidating */
+#define ADVISOR_TYPE_SHARE 0.05
+/* Own render work of a filter below which its extra render pass is the main cost, in ns */
+#define ADVISOR_IDLE_FILTER 50000
+/* Async input rate against the canvas rate before the surplus is worth mentioning */
+#define ADVISOR_ASYNC_RATE 1.1
+
+static QString ms_text(uint64_t ns)
+{
+	return QString::asprintf("%.02f", (double)ns / 1000000.0);
+}
+
+static bool oversized(const AdvisorCanvas &canvas, const AdvisorSource &source, QString &detail, uint64_t &savings)
+{
+	if (source.kind != OBS_SOURCE_TYPE_INPUT || !(source.flags & OBS_SOURCE_VIDEO) || !source.showing)
+		return false;
+	double area = (double)source.width * (double)source.height;
+	double canvasArea = (double)canvas.width * (double)canvas.height;
+	if (canvasArea <= 0.0 || area <= canvasArea * ADVISOR_OVERSIZE)
+		return false;
+	detail = QString::fromUtf8(obs_module_text("PerfViewer.AdvisorOversizedDetail"))
+			 .arg(source.width)
+			 .arg(source.height)
+			 .arg(canvas.width)
+			 .arg(canvas.height);
+	// Render cost roughly follows the pixels drawn
+	savings = (uint64_t)((double)(source.perf.render_sum + source.perf.render_gpu_sum) * (1.0 - canvasArea / area));
+	return true;
+}
+
+static bool not_rendered(const AdvisorCanvas &, const AdvisorSource &source, QString &detail, uint64_t &savings)
+{
+	if (source.kind != OBS_SOURCE_TYPE_INPUT || !(source.flags & OBS_SOURCE_VIDEO) || !source.active)
+		return false;
+	if (source.perf.render_sum || source.perf.async_rendered > 0.0 || !source.perf.tick_avg)
+		return false;
+	detail = QString::fromUtf8(obs_module_text("PerfViewer.AdvisorNotRenderedDetail"));
+	savings = source.perf.tick_avg;
+	return true;
+}
+
+static bool repeated_type(const AdvisorCanvas &canvas, const AdvisorSource &source, QString &detail, uint64_t &savings)
+{
+	if (source.kind != OBS_SOURCE_TYPE_INPUT || !source.type_costliest || source.type_instances < 2 || canvas.fps <= 0.0)
+		return false;
+	if ((double)source.type_cost < 1000000000.0 / canvas.fps * ADVISOR_TYPE_SHARE)
+		return false;
+	detail = QString::fromUtf8(obs_module_text("PerfViewer.AdvisorRepeatedTypeDetail"))
+			 .arg(source.type_instances)
+			 .arg(ms_text(source.type_cost));
+	// Upper bound, what is left if one instance could serve all of them
+	savings = source.type_cost - source.cost();
+	return true;
+}
+
+static bool idle_filter(const AdvisorCanvas &, const AdvisorSource &source, QString &detail, uint64_t &savings)
+{
+	if (source.kind != OBS_SOURCE_TYPE_FILTER || !source.enabled || !source.showing)
+		return false;
+	if ((source.flags & OBS_SOURCE_ASYNC_VIDEO) != OBS_SOURCE_VIDEO)
+		return false;
+	uint64_t own = source.perf.render_sum + source.perf.render_gpu_sum;
+	if (!own || own >= ADVISOR_IDLE_FILTER)
+		return false;
+	detail = QString::fromUtf8(obs_module_text("PerfViewer.AdvisorIdleFilterDetail")).arg(ms_text(own));
+	savings = own;
+	return true;
+}
+
+static bool async_rate(const AdvisorCanvas &canvas, const AdvisorSource &source, QString &detail, uint64_t &savings)
+{
+	if (!(source.flags & OBS_SOURCE_ASYNC) || !source.active || canvas.fps <= 0.0)
+		return false;
+	double input = source.perf.async_input;
+	if (input <= canvas.fps * ADVISOR_ASYNC_RATE)
+		return false;
+	detail = QString::fromUtf8(obs_module_text("PerfViewer.AdvisorAsyncRateDetail"))
+			 .arg(QString::asprintf("%.02f", input))
+			 .arg(QString::asprintf("%.02f", canvas.fps));
+	// Frame handling in tick scales with the input rate, decoding in the source's own thread is not measured
+	savings = (uint64_t)((double)source.perf.tick_avg * (1.0 - canvas.fps / input));
+	return true;
+}
+
+static const AdvisorRule rules[] = {
+	{"PerfViewer.AdvisorOversized", oversized},
+	{"PerfViewer.AdvisorNotRendered", not_rendered},
+	{"PerfViewer.AdvisorRepeatedType", repeated_type},
+	{"PerfViewer.AdvisorIdleFilter", idle_filter},
+	{"PerfViewer.AdvisorAsyncRate", async_rate},
+};
+
+void AdvisorSource::expressionInput(ExpressionInput &input) const
+{
+	input.setResult(&perf);
+	input.setSize(width, height);
+	input.setCanvas();
+	input.values[EXPRESSION_SHARE] = 1.0;
+	input.values[EXPRESSION_ACTIVE] = active;
+	input.values[EXPRESSION_RENDERED] = showing;
+	input.values[EXPRESSION_ENABLED] = enabled;
+	input.values[EXPRESSION_ASYNC] = (flags & OBS_SOURCE_ASYNC) != 0;
+	input.values[EXPRESSION_FILTER] = kind == OBS_SOURCE_TYPE_FILTER;
+}
+
+PerfAdvisor::PerfAdvisor(PerfTreeModel *m, QObject *parent) : QObject(parent), model(m) {}
+
+void PerfAdvisor::setAlerts(const QList<ExpressionColumn> &columns)
+{
+	alerts.clear();
+	for (const auto &column : columns) {
+		if (column.alert && column.expression && !column.expression->isEmpty())
+			alerts.append(column);
+	}
+}
+
+void PerfAdvisor::addFinding(const QString &rule, const AdvisorSource &source, const QString &detail, uint64_t savings)
+{
+	Finding f{rule, QString(), QString(), detail, savings};
+	obs_source_t *s = obs_weak_source_get_source(source.weak);
+	if (s) {
+		f.name = QString::fromUtf8(obs_source_get_name(s));
+		f.type = QString::fromUtf8(obs_source_get_display_name(source.id));
+		obs_source_release(s);
+	}
+	findings.append(f);
+}
+
+void PerfAdvisor::sample()
+{
+	sources.clear();
+	// Scenes only aggregate their items, transitions are covered by their own report
+	model->forEachSample([this](obs_weak_source_t *weak, const PerfSourceSample &sample) {
+		if (sample.kind == OBS_SOURCE_TYPE_SCENE || sample.kind == OBS_SOURCE_TYPE_TRANSITION)
+			return;
+		obs_source_t *source = obs_weak_source_get_source(weak);
+		if (!source)
+			return;
+		AdvisorSource s;
+		s.kind = sample.kind;
+		s.perf = sample.exclusive;
+		s.flags = obs_source_get_output_flags(source);
+		s.id = obs_source_get_unversioned_id(source);
+		if (s.kind == OBS_SOURCE_TYPE_FILTER) {
+			obs_source_t *parent = obs_filter_get_parent(source);
+			s.enabled = obs_source_enabled(source);
+			s.active = s.enabled && parent && obs_source_active(parent);
+			s.showing = s.enabled && parent && obs_source_showing(parent);
+		} else {
+			s.active = obs_source_active(source);
+			s.showing = obs_source_showing(source);
+			s.width = obs_source_get_width(source);
+			s.height = obs_source_get_height(source);
+		}
+		obs_source_release(source);
+		obs_weak_source_addref(weak);
+		s.weak = weak;
+		sources.append(s);
+	});
+
+	AdvisorCanvas canvas;
+	struct obs_video_info ovi;
+	if (obs_get_video_info(&ovi)) {
+		canvas.width = ovi.base_width;
+		canvas.height = ovi.base_height;
+	}
+	uint64_t interval = obs_get_frame_interval_ns();
+	canvas.fps = interval ? 1000000000.0 / (double)interval : 0.0;
+
+	// Instances per type, the costliest active one carries the type's total
+	QHash<QByteArray, int> costliest;
+	for (int i = 0; i < sources.count(); i++) {
+		if (!sources[i].active)
+			continue;
+		QByteArray id(sources[i].id);
+		auto it = costliest.find(id);
+		if (it == costliest.end())
+			costliest.insert(id, i);
+		else if (sources[i].cost() > sources[it.value()].cost())
+			it.value() = i;
+	}
+	for (auto &s : sources) {
+		if (!s.active)
+			continue;
+		auto &top = sources[costliest.value(QByteArray(s.id))];
+		top.type_instances++;
+		top.type_cost += s.cost();
+	}
+	for (auto it = costliest.begin(); it != costliest.end(); ++it)
+		sources[it.value()].type_costliest = true;
+
+	findings.clear();
+	for (const auto &s : sources) {
+		for (const auto &rule : rules) {
+			QString detail;
+			uint64_t savings = 0;
+			if (rule.check(canvas, s, detail, savings))
+				addFinding(QString::fromUtf8(obs_module_text(rule.name)), s, detail, savings);
+		}
+		if (alerts.isEmpty())
+			continue;
+		ExpressionInput input;
+		s.expressionInput(input);
+		for (const auto &alert : alerts) {
+			double value = alert.expression->evaluate(input);
+			if (value == 0.0)
+				continue;
+			// Nothing to estimate, the user decided what matters
+			addFinding(alert.name, s, QString::fromUtf8("%1 = %2").arg(alert.text).arg(value), 0);
+		}
+	}
+	for (const auto &s : sources)
+		obs_weak_source_release(s.weak);
+	sources.clear();
+	std::sort(findings.begin(), findings.end(), [](const Finding &a, const Finding &b) { return a.savings > b.savings; });
+}
+
+QList<QStringList> PerfAdvisor::results() const
+{
+	QList<QStringList> rows;
+	for (const auto &f : findings)
+		rows.append(QStringList{f.rule, f.name, f.type, f.detail, ms_text(f.savings)});
+	return rows;
+}
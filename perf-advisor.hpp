@@ -0,0 +1,80 @@
+#pragma once
+
+#include "obs-module.h"
+#include "perf-expression.hpp"
+#include "perf-util.hpp"
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <util/source-profiler.h>
+
+class PerfTreeModel;
+
+/* What a rule sees of one source, gathered once per pass from the model's samples */
+struct AdvisorSource {
+	/* Referenced for the pass, names are only looked up for findings */
+	obs_weak_source_t *weak = nullptr;
+	const char *id = nullptr;
+	enum obs_source_type kind = OBS_SOURCE_TYPE_INPUT;
+	uint32_t flags = 0;
+	bool active = false;
+	bool showing = false;
+	bool enabled = true;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	/* Exclusive result for filters */
+	profiler_result_t perf = {};
+	/* Active instances of the same type and their combined cost in ns */
+	int type_instances = 0;
+	uint64_t type_cost = 0;
+	/* Most expensive instance of its type, type rules report only this one */
+	bool type_costliest = false;
+
+	uint64_t cost() const { return total_cost(&perf); }
+	/* Variables for alert expressions, sources outside a tree have no share or children */
+	void expressionInput(ExpressionInput &input) const;
+};
+
+struct AdvisorCanvas {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	double fps = 0.0;
+};
+
+/* Rule from the table in perf-advisor.cpp, fills detail and the estimated savings in ns when it matches */
+struct AdvisorRule {
+	const char *name;
+	bool (*check)(const AdvisorCanvas &canvas, const AdvisorSource &source, QString &detail, uint64_t &savings);
+};
+
+/* Runs the advisor rules over the model's samples of every source after each pass */
+class PerfAdvisor : public QObject {
+	Q_OBJECT
+
+	struct Finding {
+		QString rule;
+		QString name;
+		QString type;
+		QString detail;
+		uint64_t savings;
+	};
+
+	PerfTreeModel *model;
+	QList<AdvisorSource> sources;
+	QList<Finding> findings;
+	QList<ExpressionColumn> alerts;
+
+	void addFinding(const QString &rule, const AdvisorSource &source, const QString &detail, uint64_t savings);
+
+public:
+	PerfAdvisor(PerfTreeModel *model, QObject *parent = nullptr);
+
+	/* Expression columns marked as alert become rules, matching where they are not 0 */
+	void setAlerts(const QList<ExpressionColumn> &columns);
+
+	/* Findings, largest estimated savings first */
+	QList<QStringList> results() const;
+
+public slots:
+	void sample();
+};
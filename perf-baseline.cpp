@@ -0,0 +1,124 @@
+
+#include "perf-baseline.hpp"
+#include <obs-frontend-api.h>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <util/platform.h>
+#include <algorithm>
+
+QString collection_config_path(const char *directory, const QString &collection)
+{
+	auto file = collection;
+	file.replace(QRegularExpression(QString::fromUtf8("[^\\w\\- ]")), QString::fromUtf8("_"));
+	char *path = obs_module_config_path(QString::fromUtf8("%1/%2.json").arg(directory).arg(file).toUtf8().constData());
+	QString result = QString::fromUtf8(path);
+	bfree(path);
+	return result;
+}
+
+/* One file per scene collection, holding every baseline of that collection */
+static QString baseline_path(const QString &collection)
+{
+	return collection_config_path("baselines", collection);
+}
+
+static QJsonObject baseline_file(const QString &collection)
+{
+	char *text = os_quick_read_utf8_file(baseline_path(collection).toUtf8().constData());
+	if (!text)
+		return {};
+	auto document = QJsonDocument::fromJson(QByteArray(text));
+	bfree(text);
+	return document.object();
+}
+
+static bool baseline_write(const QString &collection, const QJsonObject &file)
+{
+	char *dir = obs_module_config_path("baselines");
+	os_mkdirs(dir);
+	bfree(dir);
+	auto json = QJsonDocument(file).toJson(QJsonDocument::Compact);
+	return os_quick_write_utf8_file(baseline_path(collection).toUtf8().constData(), json.constData(), (size_t)json.size(),
+					false);
+}
+
+QString baseline_collection()
+{
+	char *name = obs_frontend_get_current_scene_collection();
+	QString collection = QString::fromUtf8(name);
+	bfree(name);
+	return collection;
+}
+
+const BaselineSource *PerfBaseline::find(const QString &key) const
+{
+	auto it = sources.constFind(key);
+	return it == sources.constEnd() ? nullptr : &it.value();
+}
+
+bool PerfBaseline::save(const QString &collection) const
+{
+	QJsonObject saved;
+	for (auto it = sources.constBegin(); it != sources.constEnd(); ++it) {
+		QJsonObject values;
+		for (auto v = it.value().values.constBegin(); v != it.value().values.constEnd(); ++v)
+			values.insert(v.key(), v.value());
+		QJsonObject source;
+		source.insert("name", it.value().name);
+		source.insert("values", values);
+		saved.insert(it.key(), source);
+	}
+	QJsonObject baseline;
+	baseline.insert("captured", captured);
+	baseline.insert("show_mode", showMode);
+	baseline.insert("attribution", attribution);
+	baseline.insert("sources", saved);
+	auto file = baseline_file(collection);
+	file.insert(name, baseline);
+	return baseline_write(collection, file);
+}
+
+bool PerfBaseline::load(const QString &collection, const QString &name, PerfBaseline &baseline)
+{
+	auto file = baseline_file(collection);
+	if (!file.contains(name))
+		return false;
+	auto object = file.value(name).toObject();
+	baseline.name = name;
+	baseline.captured = object.value("captured").toInteger();
+	baseline.showMode = object.value("show_mode").toInt(-1);
+	baseline.attribution = object.value("attribution").toInt(-1);
+	baseline.sources.clear();
+	auto saved = object.value("sources").toObject();
+	for (const auto &key : saved.keys()) {
+		auto source = saved.value(key).toObject();
+		BaselineSource s;
+		s.name = source.value("name").toString();
+		auto values = source.value("values").toObject();
+		for (const auto &column : values.keys())
+			s.values.insert(column, values.value(column).toDouble());
+		baseline.sources.insert(key, s);
+	}
+	return true;
+}
+
+void PerfBaseline::remove(const QString &collection, const QString &name)
+{
+	auto file = baseline_file(collection);
+	if (!file.contains(name))
+		return;
+	file.remove(name);
+	baseline_write(collection, file);
+}
+
+QStringList PerfBaseline::names(const QString &collection)
+{
+	auto file = baseline_file(collection);
+	auto names = file.keys();
+	std::sort(names.begin(), names.end(), [&file](const QString &a, const QString &b) {
+		return file.value(a).toObject().value("captured").toInteger() >
+		       file.value(b).toObject().value("captured").toInteger();
+	});
+	return names;
+}
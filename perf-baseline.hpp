@@ -0,0 +1,38 @@
+#pragma once
+
+#include "obs-module.h"
+#include <QHash>
+#include <QStringList>
+
+/* Numeric column values of one row when the baseline was captured, by column key */
+struct BaselineSource {
+	QString name;
+	QHash<QString, double> values;
+};
+
+/* Named capture of the tree's statistics, saved per scene collection */
+class PerfBaseline {
+public:
+	QString name;
+	/* ms since the epoch */
+	qint64 captured = 0;
+	/* PerfTreeModel::ShowMode and SharedAttribution of the tree it was captured from, -1 when not saved */
+	int showMode = -1;
+	int attribution = -1;
+	/* By PerfTreeItem::baselineKey, the UUIDs of the placement so it survives renames */
+	QHash<QString, BaselineSource> sources;
+
+	const BaselineSource *find(const QString &key) const;
+
+	/* Appends or replaces this baseline in the collection's file */
+	bool save(const QString &collection) const;
+	static bool load(const QString &collection, const QString &name, PerfBaseline &baseline);
+	static void remove(const QString &collection, const QString &name);
+	/* Baselines saved for a collection, newest first */
+	static QStringList names(const QString &collection);
+};
+
+/* Name of the current scene collection */
+QString baseline_collection();
+/* JSON file for a scene collection in a directory of the module config */
+QString collection_config_path(const char *directory, const QString &collection);
@@ -0,0 +1,110 @@
+
+#include "perf-budget.hpp"
+#include "source-profiler.hpp"
+#include <QPainter>
+#include <algorithm>
+
+/* Samples kept for the bars, one per refresh */
+#define BUDGET_HISTORY 120
+
+PerfBudgetSample perf_budget_sample(const PerfTreeModel *model)
+{
+	PerfBudgetSample sample;
+	model->forEachSample([&sample](obs_weak_source_t *, const PerfSourceSample &s) { sample.tick += s.perf.tick_avg; });
+
+	// Render costs include everything below, so only channel roots are added, each once
+	QList<obs_source_t *> roots;
+	for (uint32_t i = 0; i < MAX_CHANNELS; i++) {
+		obs_source_t *source = obs_get_output_source(i);
+		if (!source)
+			continue;
+		if (!roots.contains(source)) {
+			roots.append(source);
+			obs_weak_source_t *weak = obs_source_get_weak_source(source);
+			PerfSourceSample s;
+			if (model->sourceSample(weak, s)) {
+				sample.render += s.perf.render_sum;
+				sample.gpu += s.perf.render_gpu_sum;
+			}
+			obs_weak_source_release(weak);
+		}
+		obs_source_release(source);
+	}
+	sample.frame = obs_get_average_frame_time_ns();
+	return sample;
+}
+
+PerfBudgetWidget::PerfBudgetWidget(PerfTreeModel *m, QWidget *parent) : QWidget(parent), model(m)
+{
+	setFixedHeight(64);
+}
+
+void PerfBudgetWidget::sample()
+{
+	if (!isVisible())
+		return;
+	history.append(perf_budget_sample(model));
+	while (history.count() > BUDGET_HISTORY)
+		history.removeFirst();
+	setToolTip(QString::fromUtf8(obs_module_text("PerfViewer.BudgetGpu")) +
+		   QString::asprintf(" %.02f ms", (double)history.last().gpu / 1000000.0));
+	update();
+}
+
+void PerfBudgetWidget::paintEvent(QPaintEvent *)
+{
+	static const char *labels[] = {"PerfViewer.BudgetTick", "PerfViewer.BudgetRender", "PerfViewer.BudgetUnattributed",
+				       "PerfViewer.BudgetFrame"};
+	QPainter painter(this);
+	auto fm = painter.fontMetrics();
+	int textWidth = 0;
+	for (auto label : labels)
+		textWidth = std::max(textWidth, fm.horizontalAdvance(QString::fromUtf8(obs_module_text(label)) + " 00.00 ms"));
+	textWidth += 8;
+	int chartWidth = width() - textWidth;
+	int chartHeight = height() - 2;
+	if (chartWidth <= 0 || chartHeight <= 0 || history.isEmpty())
+		return;
+
+	uint64_t interval = obs_get_frame_interval_ns();
+	uint64_t scale = interval;
+	for (const auto &s : history)
+		scale = std::max(scale, std::max(s.frame, s.tick + s.render));
+	if (!scale)
+		return;
+
+	// https://coolors.co/palette/5b6273-718cdc-eabc48-e85e75
+	const QColor tickColor(91, 98, 115);
+	const QColor renderColor(113, 140, 220);
+	const QColor unattributedColor(232, 94, 117);
+
+	int barWidth = std::max(1, chartWidth / BUDGET_HISTORY);
+	int x = chartWidth - (int)history.count() * barWidth;
+	for (const auto &s : history) {
+		int y = height() - 1;
+		for (auto part : {std::make_pair(s.tick, tickColor), std::make_pair(s.render, renderColor),
+				  std::make_pair(s.unattributed(), unattributedColor)}) {
+			int h = (int)((double)part.first / (double)scale * chartHeight);
+			if (h > 0)
+				painter.fillRect(x, y - h, barWidth, h, part.second);
+			y -= h;
+		}
+		x += barWidth;
+	}
+
+	// Frame interval line: everything above it misses the frame
+	int budgetY = height() - 1 - (int)((double)interval / (double)scale * chartHeight);
+	painter.setPen(palette().color(QPalette::WindowText));
+	painter.drawLine(0, budgetY, chartWidth, budgetY);
+
+	const auto &last = history.last();
+	int lineHeight = height() / 4;
+	const uint64_t values[] = {last.tick, last.render, last.unattributed(), last.frame};
+	const QColor colors[] = {tickColor, renderColor, unattributedColor, palette().color(QPalette::WindowText)};
+	for (int i = 0; i < 4; i++) {
+		painter.setPen(colors[i]);
+		painter.drawText(QRect(chartWidth + 4, i * lineHeight, textWidth - 4, lineHeight), Qt::AlignLeft | Qt::AlignVCenter,
+				 QString::fromUtf8(obs_module_text(labels[i])) +
+					 QString::asprintf(" %.02f ms", (double)values[i] / 1000000.0));
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "obs-module.h"
+#include <QList>
+#include <QWidget>
+
+class PerfTreeModel;
+
+/* Where the frame went, averaged over the profiler window, in ns */
+struct PerfBudgetSample {
+	/* Tick of every source, each counted once */
+	uint64_t tick = 0;
+	/* CPU render of the sources on the output channels, including everything they render */
+	uint64_t render = 0;
+	uint64_t gpu = 0;
+	/* Average frame time measured by libobs */
+	uint64_t frame = 0;
+
+	uint64_t unattributed() const { return frame > tick + render ? frame - tick - render : 0; }
+};
+
+PerfBudgetSample perf_budget_sample(const PerfTreeModel *model);
+
+/* Stacked bars of the frame budget over time against the frame interval */
+class PerfBudgetWidget : public QWidget {
+	Q_OBJECT
+
+	PerfTreeModel *model;
+	QList<PerfBudgetSample> history;
+
+public:
+	PerfBudgetWidget(PerfTreeModel *model, QWidget *parent = nullptr);
+
+public slots:
+	void sample();
+
+protected:
+	void paintEvent(QPaintEvent *event) override;
+};
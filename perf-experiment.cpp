@@ -0,0 +1,266 @@
+
+#include "perf-experiment.hpp"
+#include "perf-util.hpp"
+#include <QTimer>
+#include <util/source-profiler.h>
+#include <algorithm>
+#include <cmath>
+
+/* Samples per phase */
+#define EXPERIMENT_SAMPLES 12
+/* Time between samples, longer than the profiler's averaging window so no two samples share frames */
+#define EXPERIMENT_INTERVAL 2000
+/* Samples skipped after each toggle or restore so the profiler averages only cover the new state */
+#define EXPERIMENT_SETTLE 1
+
+void ExperimentSamples::add(double value)
+{
+	count++;
+	double delta = value - mean;
+	mean += delta / count;
+	m2 += delta * (value - mean);
+}
+
+PerfExperimentRunner::PerfExperimentRunner(QObject *parent) : QObject(parent)
+{
+	timer = new QTimer(this);
+	timer->setInterval(EXPERIMENT_INTERVAL);
+	connect(timer, &QTimer::timeout, this, &PerfExperimentRunner::sample);
+}
+
+PerfExperimentRunner::~PerfExperimentRunner()
+{
+	stop();
+	for (auto &candidate : queue)
+		obs_weak_source_release(candidate.source);
+}
+
+/* True when the target is waiting or being measured */
+bool PerfExperimentRunner::pending(obs_source_t *source, int64_t sceneitem_id) const
+{
+	for (const auto &candidate : queue) {
+		if (candidate.status != ExperimentCandidate::QUEUED && candidate.status != ExperimentCandidate::BASELINE &&
+		    candidate.status != ExperimentCandidate::TOGGLED)
+			continue;
+		if (candidate.sceneitem_id == sceneitem_id && obs_weak_source_references_source(candidate.source, source))
+			return true;
+	}
+	return false;
+}
+
+void PerfExperimentRunner::addFilter(obs_source_t *filter)
+{
+	if (pending(filter, -1))
+		return;
+	ExperimentCandidate candidate;
+	obs_source_t *parent = obs_filter_get_parent(filter);
+	candidate.name = QString::fromUtf8(obs_source_get_name(filter));
+	if (parent)
+		candidate.name = QString::fromUtf8(obs_source_get_name(parent)) + " / " + candidate.name;
+	candidate.source = obs_source_get_weak_source(filter);
+	queue.append(candidate);
+	if (current < 0)
+		startNext();
+}
+
+void PerfExperimentRunner::addSceneItem(obs_sceneitem_t *item)
+{
+	obs_source_t *scene = obs_scene_get_source(obs_sceneitem_get_scene(item));
+	if (pending(scene, obs_sceneitem_get_id(item)))
+		return;
+	ExperimentCandidate candidate;
+	candidate.name = QString::fromUtf8(obs_source_get_name(scene)) + " / " +
+			 QString::fromUtf8(obs_source_get_name(obs_sceneitem_get_source(item)));
+	candidate.source = obs_source_get_weak_source(scene);
+	candidate.sceneitem_id = obs_sceneitem_get_id(item);
+	queue.append(candidate);
+	if (current < 0)
+		startNext();
+}
+
+/* Turns the candidate on or off, returns false when it no longer exists */
+bool PerfExperimentRunner::setCandidateState(ExperimentCandidate &candidate, bool on)
+{
+	obs_source_t *source = obs_weak_source_get_source(candidate.source);
+	if (!source)
+		return false;
+	bool found = true;
+	if (candidate.sceneitem_id < 0) {
+		obs_source_set_enabled(source, on);
+	} else {
+		obs_sceneitem_t *item = obs_scene_find_sceneitem_by_id(obs_scene_from_source(source), candidate.sceneitem_id);
+		if (item)
+			obs_sceneitem_set_visible(item, on);
+		else
+			found = false;
+	}
+	obs_source_release(source);
+	return found;
+}
+
+/* The source whose cost changes with the candidate: the filter's parent or the item's scene */
+obs_source_t *PerfExperimentRunner::parentSource(const ExperimentCandidate &candidate)
+{
+	obs_source_t *source = obs_weak_source_get_source(candidate.source);
+	if (!source || candidate.sceneitem_id >= 0)
+		return source;
+	obs_source_t *parent = obs_source_get_ref(obs_filter_get_parent(source));
+	obs_source_release(source);
+	return parent;
+}
+
+void PerfExperimentRunner::startNext()
+{
+	current = -1;
+	for (int i = 0; i < queue.count(); i++) {
+		if (queue[i].status != ExperimentCandidate::QUEUED)
+			continue;
+		auto &candidate = queue[i];
+		obs_source_t *source = obs_weak_source_get_source(candidate.source);
+		if (!source) {
+			candidate.status = ExperimentCandidate::FAILED;
+			continue;
+		}
+		bool on;
+		if (candidate.sceneitem_id < 0) {
+			on = obs_source_enabled(source);
+		} else {
+			obs_sceneitem_t *item =
+				obs_scene_find_sceneitem_by_id(obs_scene_from_source(source), candidate.sceneitem_id);
+			on = item && obs_sceneitem_visible(item);
+		}
+		obs_source_release(source);
+		// Only something that currently costs time can be measured by turning it off
+		if (!on) {
+			candidate.status = ExperimentCandidate::SKIPPED;
+			continue;
+		}
+		candidate.status = ExperimentCandidate::BASELINE;
+		current = i;
+		timer->start();
+		return;
+	}
+	timer->stop();
+}
+
+void PerfExperimentRunner::finish(ExperimentCandidate::Status status)
+{
+	auto &candidate = queue[current];
+	if (candidate.status == ExperimentCandidate::TOGGLED) {
+		setCandidateState(candidate, true);
+		// The next baseline must not include frames from while this one was off
+		settle = EXPERIMENT_SETTLE;
+	}
+	candidate.status = status;
+	startNext();
+}
+
+void PerfExperimentRunner::stop()
+{
+	for (auto &candidate : queue) {
+		if (candidate.status == ExperimentCandidate::QUEUED)
+			candidate.status = ExperimentCandidate::SKIPPED;
+	}
+	if (current >= 0)
+		finish(ExperimentCandidate::FAILED);
+	timer->stop();
+}
+
+void PerfExperimentRunner::sample()
+{
+	if (current < 0) {
+		timer->stop();
+		return;
+	}
+	if (settle > 0) {
+		settle--;
+		return;
+	}
+	auto &candidate = queue[current];
+	obs_source_t *parent = parentSource(candidate);
+	profiler_result_t perf;
+	if (!parent || !source_profiler_fill_result(parent, &perf)) {
+		obs_source_release(parent);
+		finish(ExperimentCandidate::FAILED);
+		return;
+	}
+	obs_source_release(parent);
+
+	double parentCost = (double)total_cost(&perf);
+	double frameCost = (double)obs_get_average_frame_time_ns();
+	if (candidate.status == ExperimentCandidate::BASELINE) {
+		candidate.parent_before.add(parentCost);
+		candidate.frame_before.add(frameCost);
+		if (candidate.parent_before.count < EXPERIMENT_SAMPLES)
+			return;
+		if (!setCandidateState(candidate, false)) {
+			finish(ExperimentCandidate::FAILED);
+			return;
+		}
+		candidate.status = ExperimentCandidate::TOGGLED;
+		settle = EXPERIMENT_SETTLE;
+	} else {
+		candidate.parent_after.add(parentCost);
+		candidate.frame_after.add(frameCost);
+		if (candidate.parent_after.count >= EXPERIMENT_SAMPLES)
+			finish(ExperimentCandidate::DONE);
+	}
+}
+
+/* Two-sided 95% quantile of Student's t for 1 to 30 degrees of freedom */
+static const double t_quantiles[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+				       2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+				       2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+/* Mean saving in ms with a Welch 95% confidence interval from the two phases */
+static QString saving_text(const ExperimentSamples &before, const ExperimentSamples &after)
+{
+	if (!before.count || !after.count)
+		return {};
+	double saving = before.mean - after.mean;
+	double a = before.variance() / before.count;
+	double b = after.variance() / after.count;
+	double interval = 0.0;
+	if (a + b > 0.0 && before.count > 1 && after.count > 1) {
+		// Welch-Satterthwaite degrees of freedom
+		double df = (a + b) * (a + b) / (a * a / (before.count - 1) + b * b / (after.count - 1));
+		int i = std::clamp((int)df, 1, 31) - 1;
+		interval = (i < 30 ? t_quantiles[i] : 1.96) * std::sqrt(a + b);
+	}
+	return QString::asprintf("%.03f ± %.03f", saving / 1000000.0, interval / 1000000.0);
+}
+
+QList<QStringList> PerfExperimentRunner::results() const
+{
+	QList<QStringList> rows;
+	for (const auto &candidate : queue) {
+		QString status;
+		switch (candidate.status) {
+		case ExperimentCandidate::QUEUED:
+			status = QString::fromUtf8(obs_module_text("PerfViewer.ExperimentQueued"));
+			break;
+		case ExperimentCandidate::BASELINE:
+			status = QString::fromUtf8(obs_module_text("PerfViewer.ExperimentBaseline"))
+					 .arg(candidate.parent_before.count)
+					 .arg(EXPERIMENT_SAMPLES);
+			break;
+		case ExperimentCandidate::TOGGLED:
+			status = QString::fromUtf8(obs_module_text("PerfViewer.ExperimentToggled"))
+					 .arg(candidate.parent_after.count)
+					 .arg(EXPERIMENT_SAMPLES);
+			break;
+		case ExperimentCandidate::DONE:
+			status = QString::fromUtf8(obs_module_text("PerfViewer.ExperimentDone"));
+			break;
+		case ExperimentCandidate::SKIPPED:
+			status = QString::fromUtf8(obs_module_text("PerfViewer.ExperimentSkipped"));
+			break;
+		case ExperimentCandidate::FAILED:
+			status = QString::fromUtf8(obs_module_text("PerfViewer.ExperimentFailed"));
+			break;
+		}
+		rows.append({candidate.name, status, saving_text(candidate.parent_before, candidate.parent_after),
+			     saving_text(candidate.frame_before, candidate.frame_after)});
+	}
+	return rows;
+}
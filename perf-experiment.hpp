@@ -0,0 +1,64 @@
+#pragma once
+
+#include "obs-module.h"
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QTimer;
+
+/* Running mean and variance of one measured cost, in ns */
+struct ExperimentSamples {
+	int count = 0;
+	double mean = 0.0;
+	double m2 = 0.0;
+
+	void add(double value);
+	double variance() const { return count > 1 ? m2 / (count - 1) : 0.0; }
+};
+
+/* Disables a filter or hides a scene item, then restores it */
+struct ExperimentCandidate {
+	enum Status { QUEUED, BASELINE, TOGGLED, DONE, SKIPPED, FAILED };
+
+	QString name;
+	/* Filter or scene that owns the scene item */
+	obs_weak_source_t *source = nullptr;
+	int64_t sceneitem_id = -1;
+	Status status = QUEUED;
+	ExperimentSamples parent_before;
+	ExperimentSamples parent_after;
+	ExperimentSamples frame_before;
+	ExperimentSamples frame_after;
+};
+
+/* Runs queued experiments one after another on the UI thread */
+class PerfExperimentRunner : public QObject {
+	Q_OBJECT
+
+	QList<ExperimentCandidate> queue;
+	int current = -1;
+	/* Samples still to skip while the profiler window fills after a toggle or restore */
+	int settle = 0;
+	QTimer *timer = nullptr;
+
+	bool pending(obs_source_t *source, int64_t sceneitem_id) const;
+	bool setCandidateState(ExperimentCandidate &candidate, bool on);
+	obs_source_t *parentSource(const ExperimentCandidate &candidate);
+	void startNext();
+	void finish(ExperimentCandidate::Status status);
+
+public:
+	PerfExperimentRunner(QObject *parent = nullptr);
+	~PerfExperimentRunner() override;
+
+	void addFilter(obs_source_t *filter);
+	void addSceneItem(obs_sceneitem_t *item);
+	void stop();
+
+	QList<QStringList> results() const;
+
+private slots:
+	void sample();
+};
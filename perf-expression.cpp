@@ -0,0 +1,607 @@
+
+#include "perf-expression.hpp"
+#include "perf-util.hpp"
+#include <obs-frontend-api.h>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+static const char *variable_names[EXPRESSION_VARIABLE_COUNT] = {
+	"tick",     "tick_max",   "render",  "render_max", "render_total", "gpu",
+	"gpu_max",  "gpu_total",  "total",   "async_input", "async_rendered", "width",
+	"height",   "megapixels", "renders", "share",      "children",     "active",
+	"rendered", "enabled",    "async",   "filter",     "frame",        "fps",
+};
+
+void ExpressionInput::setResult(const profiler_result_t *perf)
+{
+	values[EXPRESSION_TICK] = ns_to_ms(perf->tick_avg);
+	values[EXPRESSION_TICK_MAX] = ns_to_ms(perf->tick_max);
+	values[EXPRESSION_RENDER] = ns_to_ms(perf->render_avg);
+	values[EXPRESSION_RENDER_MAX] = ns_to_ms(perf->render_max);
+	values[EXPRESSION_RENDER_TOTAL] = ns_to_ms(perf->render_sum);
+	values[EXPRESSION_GPU] = ns_to_ms(perf->render_gpu_avg);
+	values[EXPRESSION_GPU_MAX] = ns_to_ms(perf->render_gpu_max);
+	values[EXPRESSION_GPU_TOTAL] = ns_to_ms(perf->render_gpu_sum);
+	values[EXPRESSION_TOTAL] = ns_to_ms(total_cost(perf));
+	values[EXPRESSION_ASYNC_INPUT] = perf->async_input;
+	values[EXPRESSION_ASYNC_RENDERED] = perf->async_rendered;
+	values[EXPRESSION_RENDERS] = perf->render_avg ? (double)perf->render_sum / (double)perf->render_avg : 0.0;
+}
+
+void ExpressionInput::setSize(uint32_t width, uint32_t height)
+{
+	values[EXPRESSION_WIDTH] = (double)width;
+	values[EXPRESSION_HEIGHT] = (double)height;
+	values[EXPRESSION_MEGAPIXELS] = (double)width * (double)height / 1000000.0;
+}
+
+void ExpressionInput::setCanvas()
+{
+	uint64_t interval = obs_get_frame_interval_ns();
+	values[EXPRESSION_FRAME] = ns_to_ms(interval);
+	values[EXPRESSION_FPS] = interval ? 1000000000.0 / (double)interval : 0.0;
+}
+
+struct PerfExpression::Parser {
+	const QString &text;
+	QList<Op> &code;
+	qsizetype pos = 0;
+	int depth = 0;
+	int maxDepth = 0;
+	int nesting = 0;
+	QString error;
+
+	Parser(const QString &t, QList<Op> &c) : text(t), code(c) {}
+
+	void skipSpace()
+	{
+		while (pos < text.size() && text.at(pos).isSpace())
+			pos++;
+	}
+
+	/* Consumes op when it is next, "<" does not match the start of "<=" */
+	bool accept(const char *op)
+	{
+		skipSpace();
+		qsizetype length = (qsizetype)strlen(op);
+		if (text.mid(pos, length) != QLatin1String(op))
+			return false;
+		if (length == 1 && pos + 1 < text.size() && text.at(pos + 1) == '=' && strchr("<>=!", op[0]))
+			return false;
+		pos += length;
+		return true;
+	}
+
+	void push(enum OpCode op, int variable = 0, double value = 0.0)
+	{
+		code.append({op, variable, value});
+		// Loads push a value, functions pop all their arguments but one, unary ops leave the depth alone
+		if (op == OP_CONST || op == OP_LOAD)
+			depth++;
+		else if (op == OP_IF)
+			depth -= 2;
+		else if (op != OP_NEG && op != OP_NOT && op != OP_ABS)
+			depth--;
+		maxDepth = std::max(maxDepth, depth);
+	}
+
+	bool fail(const QString &message)
+	{
+		if (error.isEmpty())
+			error = message;
+		return false;
+	}
+
+	bool unexpected()
+	{
+		skipSpace();
+		if (pos >= text.size())
+			return fail(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionEnd")));
+		return fail(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionUnexpected")).arg(text.at(pos)).arg(pos + 1));
+	}
+
+	bool primary()
+	{
+		skipSpace();
+		if (pos >= text.size())
+			return unexpected();
+		QChar c = text.at(pos);
+		if (c.isDigit() || c == '.') {
+			qsizetype start = pos;
+			while (pos < text.size() && (text.at(pos).isDigit() || text.at(pos) == '.'))
+				pos++;
+			bool ok = false;
+			double value = text.mid(start, pos - start).toDouble(&ok);
+			if (!ok) {
+				pos = start;
+				return unexpected();
+			}
+			push(OP_CONST, 0, value);
+			return true;
+		}
+		if (c.isLetter() || c == '_') {
+			qsizetype start = pos;
+			while (pos < text.size() && (text.at(pos).isLetterOrNumber() || text.at(pos) == '_'))
+				pos++;
+			auto name = text.mid(start, pos - start).toLower();
+			if (accept("("))
+				return call(name);
+			for (int i = 0; i < EXPRESSION_VARIABLE_COUNT; i++) {
+				if (name == QLatin1String(variable_names[i])) {
+					push(OP_LOAD, i);
+					return true;
+				}
+			}
+			return fail(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionUnknown")).arg(name));
+		}
+		if (accept("(")) {
+			if (!expression())
+				return false;
+			return accept(")") || unexpected();
+		}
+		return unexpected();
+	}
+
+	bool call(const QString &name)
+	{
+		static const struct {
+			const char *name;
+			int arguments;
+			enum OpCode code;
+		} functions[] = {
+			{"min", 2, OP_MIN},
+			{"max", 2, OP_MAX},
+			{"abs", 1, OP_ABS},
+			{"if", 3, OP_IF},
+		};
+		for (const auto &function : functions) {
+			if (name != QLatin1String(function.name))
+				continue;
+			for (int i = 0; i < function.arguments; i++) {
+				if (i > 0 && !accept(","))
+					return fail(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionArguments"))
+							    .arg(name)
+							    .arg(function.arguments));
+				if (!expression())
+					return false;
+			}
+			if (!accept(")"))
+				return fail(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionArguments"))
+						    .arg(name)
+						    .arg(function.arguments));
+			push(function.code);
+			return true;
+		}
+		return fail(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionUnknown")).arg(name));
+	}
+
+	/* Every recursion passes through here, so limiting it here bounds the C++ stack */
+	bool unary()
+	{
+		if (nesting >= EXPRESSION_NESTING)
+			return fail(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionTooDeep")));
+		nesting++;
+		bool ok = prefixed();
+		nesting--;
+		return ok;
+	}
+
+	bool prefixed()
+	{
+		if (accept("-")) {
+			if (!unary())
+				return false;
+			push(OP_NEG);
+			return true;
+		}
+		if (accept("!")) {
+			if (!unary())
+				return false;
+			push(OP_NOT);
+			return true;
+		}
+		return primary();
+	}
+
+	bool product()
+	{
+		if (!unary())
+			return false;
+		for (;;) {
+			enum OpCode op;
+			if (accept("*"))
+				op = OP_MUL;
+			else if (accept("/"))
+				op = OP_DIV;
+			else
+				return true;
+			if (!unary())
+				return false;
+			push(op);
+		}
+	}
+
+	bool sum()
+	{
+		if (!product())
+			return false;
+		for (;;) {
+			enum OpCode op;
+			if (accept("+"))
+				op = OP_ADD;
+			else if (accept("-"))
+				op = OP_SUB;
+			else
+				return true;
+			if (!product())
+				return false;
+			push(op);
+		}
+	}
+
+	bool comparison()
+	{
+		if (!sum())
+			return false;
+		for (;;) {
+			enum OpCode op;
+			if (accept("<="))
+				op = OP_LE;
+			else if (accept(">="))
+				op = OP_GE;
+			else if (accept("=="))
+				op = OP_EQ;
+			else if (accept("!="))
+				op = OP_NE;
+			else if (accept("<"))
+				op = OP_LT;
+			else if (accept(">"))
+				op = OP_GT;
+			else
+				return true;
+			if (!sum())
+				return false;
+			push(op);
+		}
+	}
+
+	bool conjunction()
+	{
+		if (!comparison())
+			return false;
+		while (accept("&&")) {
+			if (!comparison())
+				return false;
+			push(OP_AND);
+		}
+		return true;
+	}
+
+	bool expression()
+	{
+		if (!conjunction())
+			return false;
+		while (accept("||")) {
+			if (!conjunction())
+				return false;
+			push(OP_OR);
+		}
+		return true;
+	}
+};
+
+bool PerfExpression::compile(const QString &text, QString *error)
+{
+	code.clear();
+	Parser parser(text, code);
+	bool ok = parser.expression();
+	parser.skipSpace();
+	if (ok && parser.pos < text.size())
+		ok = parser.unexpected();
+	if (ok && parser.maxDepth > EXPRESSION_STACK)
+		ok = parser.fail(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionTooDeep")));
+	if (!ok) {
+		code.clear();
+		if (error)
+			*error = parser.error;
+		return false;
+	}
+	return true;
+}
+
+double PerfExpression::evaluate(const ExpressionInput &input) const
+{
+	if (code.isEmpty())
+		return 0.0;
+	// The compiler checked the depth, so the fixed stack is enough
+	double stack[EXPRESSION_STACK];
+	int top = 0;
+	for (const auto &op : code) {
+		switch (op.code) {
+		case OP_CONST:
+			stack[top++] = op.value;
+			continue;
+		case OP_LOAD:
+			stack[top++] = input.values[op.variable];
+			continue;
+		case OP_NEG:
+			stack[top - 1] = -stack[top - 1];
+			continue;
+		case OP_NOT:
+			stack[top - 1] = stack[top - 1] == 0.0 ? 1.0 : 0.0;
+			continue;
+		case OP_ABS:
+			stack[top - 1] = std::abs(stack[top - 1]);
+			continue;
+		case OP_IF:
+			top -= 2;
+			stack[top - 1] = stack[top - 1] != 0.0 ? stack[top] : stack[top + 1];
+			continue;
+		default:
+			break;
+		}
+		double b = stack[--top];
+		double &a = stack[top - 1];
+		switch (op.code) {
+		case OP_ADD:
+			a += b;
+			break;
+		case OP_SUB:
+			a -= b;
+			break;
+		case OP_MUL:
+			a *= b;
+			break;
+		case OP_DIV:
+			a = b != 0.0 ? a / b : 0.0;
+			break;
+		case OP_LT:
+			a = a < b ? 1.0 : 0.0;
+			break;
+		case OP_LE:
+			a = a <= b ? 1.0 : 0.0;
+			break;
+		case OP_GT:
+			a = a > b ? 1.0 : 0.0;
+			break;
+		case OP_GE:
+			a = a >= b ? 1.0 : 0.0;
+			break;
+		case OP_EQ:
+			a = a == b ? 1.0 : 0.0;
+			break;
+		case OP_NE:
+			a = a != b ? 1.0 : 0.0;
+			break;
+		case OP_AND:
+			a = a != 0.0 && b != 0.0 ? 1.0 : 0.0;
+			break;
+		case OP_OR:
+			a = a != 0.0 || b != 0.0 ? 1.0 : 0.0;
+			break;
+		case OP_MIN:
+			a = std::min(a, b);
+			break;
+		case OP_MAX:
+			a = std::max(a, b);
+			break;
+		default:
+			break;
+		}
+	}
+	return std::isfinite(stack[0]) ? stack[0] : 0.0;
+}
+
+QStringList PerfExpression::variables()
+{
+	QStringList names;
+	for (const auto name : variable_names)
+		names.append(QString::fromUtf8(name));
+	return names;
+}
+
+QList<ExpressionColumn> expression_columns_load(const char *json)
+{
+	QList<ExpressionColumn> columns;
+	if (!json)
+		return columns;
+	auto array = QJsonDocument::fromJson(QByteArray(json)).array();
+	for (const auto &value : array) {
+		auto object = value.toObject();
+		ExpressionColumn column;
+		column.name = object.value("name").toString();
+		column.text = object.value("expression").toString();
+		column.format = (enum ExpressionFormat)std::clamp(object.value("format").toInt(), (int)EXPRESSION_FORMAT_NUMBER,
+								   (int)EXPRESSION_FORMAT_SCORE);
+		column.alert = object.value("alert").toBool();
+		auto expression = std::make_shared<PerfExpression>();
+		// Columns that no longer compile are kept so they can be fixed, they evaluate to 0
+		expression->compile(column.text);
+		column.expression = expression;
+		columns.append(column);
+	}
+	return columns;
+}
+
+QByteArray expression_columns_save(const QList<ExpressionColumn> &columns)
+{
+	QJsonArray array;
+	for (const auto &column : columns) {
+		QJsonObject object;
+		object.insert("name", column.name);
+		object.insert("expression", column.text);
+		object.insert("format", (int)column.format);
+		object.insert("alert", column.alert);
+		array.append(object);
+	}
+	return QJsonDocument(array).toJson(QJsonDocument::Compact);
+}
+
+static const char *format_names[] = {
+	"PerfViewer.ExpressionNumber",
+	"PerfViewer.ExpressionDuration",
+	"PerfViewer.ExpressionPercentage",
+	"PerfViewer.ExpressionScore",
+};
+
+PerfExpressionDialog::PerfExpressionDialog(QWidget *parent, const QList<ExpressionColumn> &c,
+					   std::function<void(const QList<ExpressionColumn> &)> apply_)
+	: QDialog(parent),
+	  columns(c),
+	  apply(apply_)
+{
+	setWindowTitle(QString::fromUtf8(obs_module_text("PerfViewer.CustomColumns")));
+	setAttribute(Qt::WA_DeleteOnClose);
+	setSizeGripEnabled(true);
+	setGeometry(0, 0, 805, 400);
+
+	list = new QTreeWidget();
+	list->setHeaderLabels({QString::fromUtf8(obs_module_text("PerfViewer.Name")),
+			       QString::fromUtf8(obs_module_text("PerfViewer.Expression")),
+			       QString::fromUtf8(obs_module_text("PerfViewer.ExpressionFormat")),
+			       QString::fromUtf8(obs_module_text("PerfViewer.ExpressionAlert"))});
+	list->setRootIsDecorated(false);
+	list->setUniformRowHeights(true);
+
+	nameEdit = new QLineEdit();
+	expressionEdit = new QLineEdit();
+	expressionEdit->setPlaceholderText(QString::fromUtf8("gpu_total / max(total, 0.01) * 100"));
+	formatBox = new QComboBox();
+	for (const auto name : format_names)
+		formatBox->addItem(QString::fromUtf8(obs_module_text(name)));
+	alertCheckBox = new QCheckBox(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionAlertHint")));
+	errorLabel = new QLabel();
+	auto variablesLabel = new QLabel(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionVariables"))
+						 .arg(PerfExpression::variables().join(", ")));
+	variablesLabel->setWordWrap(true);
+
+	auto form = new QFormLayout();
+	form->addRow(QString::fromUtf8(obs_module_text("PerfViewer.Name")), nameEdit);
+	form->addRow(QString::fromUtf8(obs_module_text("PerfViewer.Expression")), expressionEdit);
+	form->addRow(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionFormat")), formatBox);
+	form->addRow(alertCheckBox);
+	form->addRow(errorLabel);
+	form->addRow(variablesLabel);
+
+	auto addButton = new QPushButton(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionAdd")));
+	updateButton = new QPushButton(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionUpdate")));
+	removeButton = new QPushButton(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionRemove")));
+	auto buttons = new QHBoxLayout();
+	buttons->addWidget(addButton);
+	buttons->addWidget(updateButton);
+	buttons->addWidget(removeButton);
+	buttons->addStretch();
+
+	auto l = new QVBoxLayout();
+	l->addWidget(list, 1);
+	l->addLayout(form);
+	l->addLayout(buttons);
+	setLayout(l);
+
+	connect(expressionEdit, &QLineEdit::textChanged, this, [this] {
+		PerfExpression check;
+		QString error;
+		if (!expressionEdit->text().isEmpty() && !check.compile(expressionEdit->text(), &error))
+			errorLabel->setText(error);
+		else
+			errorLabel->setText(QString());
+	});
+	connect(list, &QTreeWidget::itemSelectionChanged, this, [this] {
+		int row = selectedRow();
+		updateButton->setEnabled(row >= 0);
+		removeButton->setEnabled(row >= 0);
+		if (row < 0)
+			return;
+		const auto &column = columns.at(row);
+		nameEdit->setText(column.name);
+		expressionEdit->setText(column.text);
+		formatBox->setCurrentIndex(column.format);
+		alertCheckBox->setChecked(column.alert);
+	});
+	connect(addButton, &QPushButton::clicked, this, [this] {
+		ExpressionColumn column;
+		if (!edited(column))
+			return;
+		columns.append(column);
+		changed();
+	});
+	connect(updateButton, &QPushButton::clicked, this, [this] {
+		int row = selectedRow();
+		ExpressionColumn column;
+		if (row < 0 || !edited(column))
+			return;
+		columns[row] = column;
+		changed();
+	});
+	connect(removeButton, &QPushButton::clicked, this, [this] {
+		int row = selectedRow();
+		if (row < 0)
+			return;
+		columns.removeAt(row);
+		changed();
+	});
+
+	refresh();
+	show();
+}
+
+int PerfExpressionDialog::selectedRow() const
+{
+	auto item = list->currentItem();
+	return item ? list->indexOfTopLevelItem(item) : -1;
+}
+
+bool PerfExpressionDialog::edited(ExpressionColumn &column)
+{
+	column.name = nameEdit->text().trimmed();
+	column.text = expressionEdit->text().trimmed();
+	column.format = (enum ExpressionFormat)formatBox->currentIndex();
+	column.alert = alertCheckBox->isChecked();
+	if (column.name.isEmpty()) {
+		errorLabel->setText(QString::fromUtf8(obs_module_text("PerfViewer.ExpressionNoName")));
+		return false;
+	}
+	auto expression = std::make_shared<PerfExpression>();
+	QString error;
+	if (!expression->compile(column.text, &error)) {
+		errorLabel->setText(error);
+		return false;
+	}
+	column.expression = expression;
+	return true;
+}
+
+void PerfExpressionDialog::changed()
+{
+	refresh();
+	if (apply)
+		apply(columns);
+}
+
+void PerfExpressionDialog::refresh()
+{
+	list->clear();
+	QList<QTreeWidgetItem *> items;
+	for (const auto &column : columns)
+		items.append(new QTreeWidgetItem({column.name, column.text, QString::fromUtf8(obs_module_text(format_names[column.format])),
+						  column.alert ? QString::fromUtf8(obs_frontend_get_locale_string("Yes")) : QString()}));
+	list->addTopLevelItems(items);
+	for (int i = 0; i < 4; i++)
+		list->resizeColumnToContents(i);
+	updateButton->setEnabled(false);
+	removeButton->setEnabled(false);
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "obs-module.h"
+#include <QByteArray>
+#include <QDialog>
+#include <QList>
+#include <QStringList>
+#include <functional>
+#include <memory>
+#include <util/source-profiler.h>
+
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QPushButton;
+class QTreeWidget;
+
+/* Values an expression can read, durations in ms */
+enum ExpressionVariable {
+	EXPRESSION_TICK,
+	EXPRESSION_TICK_MAX,
+	EXPRESSION_RENDER,
+	EXPRESSION_RENDER_MAX,
+	EXPRESSION_RENDER_TOTAL,
+	EXPRESSION_GPU,
+	EXPRESSION_GPU_MAX,
+	EXPRESSION_GPU_TOTAL,
+	EXPRESSION_TOTAL,
+	EXPRESSION_ASYNC_INPUT,
+	EXPRESSION_ASYNC_RENDERED,
+	EXPRESSION_WIDTH,
+	EXPRESSION_HEIGHT,
+	EXPRESSION_MEGAPIXELS,
+	EXPRESSION_RENDERS,
+	EXPRESSION_SHARE,
+	EXPRESSION_CHILDREN,
+	EXPRESSION_ACTIVE,
+	EXPRESSION_RENDERED,
+	EXPRESSION_ENABLED,
+	EXPRESSION_ASYNC,
+	EXPRESSION_FILTER,
+	EXPRESSION_FRAME,
+	EXPRESSION_FPS,
+	EXPRESSION_VARIABLE_COUNT,
+};
+
+/* One row's variables, filled per evaluation on the stack */
+struct ExpressionInput {
+	double values[EXPRESSION_VARIABLE_COUNT] = {};
+
+	/* Sets the profiler fields and the derived totals, durations converted to ms */
+	void setResult(const profiler_result_t *perf);
+	/* Sets width, height and megapixels */
+	void setSize(uint32_t width, uint32_t height);
+	/* Sets frame and fps from the current canvas rate */
+	void setCanvas();
+};
+
+/* Deepest evaluation stack a compiled expression may need */
+#define EXPRESSION_STACK 32
+/* Deepest nesting of parentheses, calls and prefix operators the parser recurses into */
+#define EXPRESSION_NESTING 64
+
+/* Arithmetic over ExpressionInput, e.g. "gpu_total / max(total, 0.01) * 100", compiled once to postfix code */
+class PerfExpression {
+	enum OpCode {
+		OP_CONST,
+		OP_LOAD,
+		OP_NEG,
+		OP_NOT,
+		OP_ADD,
+		OP_SUB,
+		OP_MUL,
+		OP_DIV,
+		OP_LT,
+		OP_LE,
+		OP_GT,
+		OP_GE,
+		OP_EQ,
+		OP_NE,
+		OP_AND,
+		OP_OR,
+		OP_MIN,
+		OP_MAX,
+		OP_ABS,
+		/* Pops else, then and the condition */
+		OP_IF,
+	};
+
+	struct Op {
+		enum OpCode code;
+		int variable;
+		double value;
+	};
+
+	QList<Op> code;
+
+	/* Recursive descent over the text, appends to code */
+	struct Parser;
+
+public:
+	/* Replaces the code, leaves it empty and fills error when the text does not parse */
+	bool compile(const QString &text, QString *error = nullptr);
+	bool isEmpty() const { return code.isEmpty(); }
+	/* Division by zero gives 0, comparisons give 1 or 0 */
+	double evaluate(const ExpressionInput &input) const;
+
+	/* Variable names in the order of ExpressionVariable */
+	static QStringList variables();
+};
+
+/* How an expression column is shown and colored, like the built-in column types */
+enum ExpressionFormat {
+	EXPRESSION_FORMAT_NUMBER,
+	/* ms, colored against the frame interval */
+	EXPRESSION_FORMAT_DURATION,
+	/* Colored from 25% up */
+	EXPRESSION_FORMAT_PERCENTAGE,
+	/* 0 to 100, colored when low */
+	EXPRESSION_FORMAT_SCORE,
+};
+
+/* User defined column, saved as config "expressions" */
+struct ExpressionColumn {
+	QString name;
+	QString text;
+	enum ExpressionFormat format = EXPRESSION_FORMAT_NUMBER;
+	/* Sources where the expression is not 0 are listed by the advisor */
+	bool alert = false;
+	std::shared_ptr<const PerfExpression> expression;
+};
+
+/* Columns from and to the JSON kept in the config, compiling each expression */
+QList<ExpressionColumn> expression_columns_load(const char *json);
+QByteArray expression_columns_save(const QList<ExpressionColumn> &columns);
+
+/* Non-modal editor of the expression columns, every change is handed to apply */
+class PerfExpressionDialog : public QDialog {
+	Q_OBJECT
+
+	QList<ExpressionColumn> columns;
+	std::function<void(const QList<ExpressionColumn> &)> apply;
+	QTreeWidget *list = nullptr;
+	QLineEdit *nameEdit = nullptr;
+	QLineEdit *expressionEdit = nullptr;
+	QComboBox *formatBox = nullptr;
+	QCheckBox *alertCheckBox = nullptr;
+	QLabel *errorLabel = nullptr;
+	QPushButton *updateButton = nullptr;
+	QPushButton *removeButton = nullptr;
+
+	int selectedRow() const;
+	/* Column from the form, false with the reason shown when it is incomplete or does not compile */
+	bool edited(ExpressionColumn &column);
+	void changed();
+	void refresh();
+
+public:
+	PerfExpressionDialog(QWidget *parent, const QList<ExpressionColumn> &columns,
+			     std::function<void(const QList<ExpressionColumn> &)> apply);
+};
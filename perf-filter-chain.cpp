@@ -0,0 +1,226 @@
+
+#include "perf-filter-chain.hpp"
+#include <QPainter>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <algorithm>
+
+static bool is_async_filter(obs_source_t *filter)
+{
+	return (obs_source_get_output_flags(filter) & OBS_SOURCE_ASYNC_VIDEO) == OBS_SOURCE_ASYNC_VIDEO;
+}
+
+/* The stage a filter renders into: skips disabled and async filters, which are not part of the render chain */
+static obs_source_t *render_target(obs_source_t *filter)
+{
+	obs_source_t *target = obs_filter_get_target(filter);
+	while (target && obs_source_get_type(target) == OBS_SOURCE_TYPE_FILTER &&
+	       (!obs_source_enabled(target) || is_async_filter(target))) {
+		target = obs_filter_get_target(target);
+	}
+	return target;
+}
+
+static uint64_t subtract(uint64_t a, uint64_t b)
+{
+	return a > b ? a - b : 0;
+}
+
+void filter_exclusive_result(obs_source_t *filter, profiler_result_t *perf)
+{
+	if (is_async_filter(filter))
+		return;
+	obs_source_t *target = render_target(filter);
+	if (!target)
+		return;
+	profiler_result_t inner;
+	if (!source_profiler_fill_result(target, &inner))
+		return;
+	perf->render_avg = subtract(perf->render_avg, inner.render_avg);
+	perf->render_sum = subtract(perf->render_sum, inner.render_sum);
+	perf->render_gpu_avg = subtract(perf->render_gpu_avg, inner.render_gpu_avg);
+	perf->render_gpu_sum = subtract(perf->render_gpu_sum, inner.render_gpu_sum);
+	// Peaks of both stages need not coincide, so the exclusive peak is never reported below the exclusive average
+	perf->render_max = std::max(subtract(perf->render_max, inner.render_max), perf->render_avg);
+	perf->render_gpu_max = std::max(subtract(perf->render_gpu_max, inner.render_gpu_max), perf->render_gpu_avg);
+}
+
+static void chain_filter(obs_source_t *, obs_source_t *filter, void *data)
+{
+	static_cast<QList<obs_source_t *> *>(data)->append(filter);
+}
+
+QList<FilterChainStage> filter_chain(obs_source_t *source)
+{
+	QList<FilterChainStage> stages;
+	if (!source)
+		return stages;
+
+	QList<obs_source_t *> filters;
+	obs_source_enum_filters(source, chain_filter, &filters);
+
+	// Order by following the targets from the outermost filter, which no other filter renders into
+	QList<obs_source_t *> ordered;
+	obs_source_t *outer = nullptr;
+	for (auto filter : filters) {
+		bool targeted = false;
+		for (auto other : filters) {
+			if (obs_filter_get_target(other) == filter) {
+				targeted = true;
+				break;
+			}
+		}
+		if (!targeted) {
+			outer = filter;
+			break;
+		}
+	}
+	for (auto filter = outer; filter && filter != source && ordered.count() < filters.count();
+	     filter = obs_filter_get_target(filter))
+		ordered.prepend(filter);
+	// Anything not reachable from the outermost filter is still listed
+	for (auto filter : filters) {
+		if (!ordered.contains(filter))
+			ordered.append(filter);
+	}
+
+	profiler_result_t perf;
+	FilterChainStage base;
+	base.name = QString::fromUtf8(obs_source_get_name(source));
+	base.is_source = true;
+	if (source_profiler_fill_result(source, &perf)) {
+		base.tick = perf.tick_avg;
+		base.cpu = perf.render_sum;
+		base.cpu_max = perf.render_max;
+		base.gpu = perf.render_gpu_sum;
+		base.gpu_max = perf.render_gpu_max;
+	}
+	stages.append(base);
+
+	for (auto filter : ordered) {
+		FilterChainStage stage;
+		stage.name = QString::fromUtf8(obs_source_get_name(filter));
+		stage.enabled = obs_source_enabled(filter);
+		stage.async = is_async_filter(filter);
+		if (stage.enabled && source_profiler_fill_result(filter, &perf)) {
+			filter_exclusive_result(filter, &perf);
+			stage.tick = perf.tick_avg;
+			stage.cpu = perf.render_sum;
+			stage.cpu_max = perf.render_max;
+			stage.gpu = perf.render_gpu_sum;
+			stage.gpu_max = perf.render_gpu_max;
+		}
+		stages.append(stage);
+	}
+	return stages;
+}
+
+PerfWaterfallWidget::PerfWaterfallWidget(QWidget *parent) : QWidget(parent)
+{
+	setMinimumHeight(100);
+}
+
+void PerfWaterfallWidget::setStages(const QList<FilterChainStage> &s)
+{
+	stages = s;
+	setMinimumHeight((int)(stages.count() + 1) * (fontMetrics().height() + 8));
+	update();
+}
+
+void PerfWaterfallWidget::paintEvent(QPaintEvent *)
+{
+	QPainter painter(this);
+	auto fm = painter.fontMetrics();
+	int rowHeight = fm.height() + 8;
+	int labelWidth = width() / 4;
+	int valueWidth = fm.horizontalAdvance(QString::fromUtf8("000.00 ms (100.0%)")) + 8;
+	int barWidth = width() - labelWidth - valueWidth;
+	if (barWidth <= 0)
+		return;
+
+	uint64_t total = 0;
+	for (const auto &stage : stages)
+		total += stage.total();
+	uint64_t frame = obs_get_frame_interval_ns();
+
+	// https://coolors.co/palette/5b6273-718cdc-eabc48-e85e75
+	const QColor tickColor(91, 98, 115);
+	const QColor cpuColor(113, 140, 220);
+	const QColor gpuColor(234, 188, 72);
+
+	uint64_t offset = 0;
+	int y = 0;
+	for (const auto &stage : stages) {
+		QRect label(4, y, labelWidth - 8, rowHeight);
+		auto name = stage.is_source ? stage.name : QString::fromUtf8("→ ") + stage.name;
+		if (!stage.enabled)
+			name += QString::fromUtf8(" (") + QString::fromUtf8(obs_module_text("PerfViewer.Disabled")) + ")";
+		else if (stage.async)
+			name += QString::fromUtf8(" (") + QString::fromUtf8(obs_module_text("PerfViewer.AsyncFilter")) + ")";
+		painter.setPen(palette().color(QPalette::WindowText));
+		painter.drawText(label, Qt::AlignLeft | Qt::AlignVCenter, fm.elidedText(name, Qt::ElideRight, label.width()));
+
+		if (total > 0) {
+			int x = labelWidth + (int)((double)offset / (double)total * barWidth);
+			for (auto part : {std::make_pair(stage.tick, tickColor), std::make_pair(stage.cpu, cpuColor),
+					  std::make_pair(stage.gpu, gpuColor)}) {
+				int w = (int)((double)part.first / (double)total * barWidth);
+				if (w > 0)
+					painter.fillRect(x, y + 4, w, rowHeight - 8, part.second);
+				x += w;
+			}
+		}
+		offset += stage.total();
+
+		QRect value(width() - valueWidth, y, valueWidth - 4, rowHeight);
+		painter.drawText(value, Qt::AlignRight | Qt::AlignVCenter,
+				 QString::asprintf("%.02f ms (%.01f%%)", (double)stage.total() / 1000000.0,
+						   frame ? (double)stage.total() / (double)frame * 100.0 : 0.0));
+		y += rowHeight;
+	}
+
+	QRect label(4, y, labelWidth - 8, rowHeight);
+	painter.drawText(label, Qt::AlignLeft | Qt::AlignVCenter, QString::fromUtf8(obs_module_text("PerfViewer.Total")));
+	QRect value(width() - valueWidth, y, valueWidth - 4, rowHeight);
+	painter.drawText(value, Qt::AlignRight | Qt::AlignVCenter,
+			 QString::asprintf("%.02f ms (%.01f%%)", (double)total / 1000000.0,
+					   frame ? (double)total / (double)frame * 100.0 : 0.0));
+}
+
+PerfFilterChainDialog::PerfFilterChainDialog(QWidget *parent, obs_source_t *s)
+	: QDialog(parent),
+	  source(obs_source_get_weak_source(s))
+{
+	setWindowTitle(QString::fromUtf8(obs_module_text("PerfViewer.FilterChain")) + " - " +
+		       QString::fromUtf8(obs_source_get_name(s)));
+	setAttribute(Qt::WA_DeleteOnClose);
+	setSizeGripEnabled(true);
+	setGeometry(0, 0, 600, 200);
+
+	waterfall = new PerfWaterfallWidget();
+	auto l = new QVBoxLayout();
+	l->addWidget(waterfall);
+	setLayout(l);
+
+	timer = new QTimer(this);
+	connect(timer, &QTimer::timeout, this, &PerfFilterChainDialog::refresh);
+	timer->start(1000);
+	refresh();
+	show();
+}
+
+PerfFilterChainDialog::~PerfFilterChainDialog()
+{
+	obs_weak_source_release(source);
+}
+
+void PerfFilterChainDialog::refresh()
+{
+	obs_source_t *s = obs_weak_source_get_source(source);
+	if (!s) {
+		close();
+		return;
+	}
+	waterfall->setStages(filter_chain(s));
+	obs_source_release(s);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "obs-module.h"
+#include <QDialog>
+#include <QList>
+#include <QString>
+#include <QWidget>
+#include <util/source-profiler.h>
+
+class QTimer;
+
+struct FilterChainStage {
+	QString name;
+	bool enabled = true;
+	/* Async video filters process frames outside the render chain */
+	bool async = false;
+	bool is_source = false;
+	/* Exclusive costs of this stage in ns */
+	uint64_t tick = 0;
+	uint64_t cpu = 0;
+	uint64_t cpu_max = 0;
+	uint64_t gpu = 0;
+	uint64_t gpu_max = 0;
+
+	uint64_t total() const { return tick + cpu + gpu; }
+};
+
+/* Turn a filter's inclusive result into its own cost by removing the next rendered stage */
+void filter_exclusive_result(obs_source_t *filter, profiler_result_t *perf);
+
+/* Source followed by its filters in the order they are applied */
+QList<FilterChainStage> filter_chain(obs_source_t *source);
+
+/* Stage bars offset by the cost of the stages before them */
+class PerfWaterfallWidget : public QWidget {
+	Q_OBJECT
+
+	QList<FilterChainStage> stages;
+
+public:
+	PerfWaterfallWidget(QWidget *parent = nullptr);
+	void setStages(const QList<FilterChainStage> &s);
+
+protected:
+	void paintEvent(QPaintEvent *event) override;
+};
+
+/* Non-modal waterfall of one source's filter chain, refreshed every second */
+class PerfFilterChainDialog : public QDialog {
+	Q_OBJECT
+
+	obs_weak_source_t *source = nullptr;
+	PerfWaterfallWidget *waterfall = nullptr;
+	QTimer *timer = nullptr;
+
+public:
+	PerfFilterChainDialog(QWidget *parent, obs_source_t *source);
+	~PerfFilterChainDialog() override;
+
+public slots:
+	void refresh();
+};
@@ -0,0 +1,40 @@
+#include "perf-frame.hpp"
+#include <algorithm>
+
+void PerfFrameCost::add(uint64_t tick_avg, uint64_t tick_max, const profiler_result_t &perf)
+{
+	frames++;
+	sum += (double)(tick_avg + perf.render_sum + perf.render_gpu_sum);
+	peak = std::max(peak, tick_max + perf.render_max + perf.render_gpu_max);
+}
+
+uint64_t PerfFrameCost::mean() const
+{
+	return frames ? (uint64_t)(sum / (double)frames) : 0;
+}
+
+PerfFrameTracker::~PerfFrameTracker()
+{
+	stopSampling();
+}
+
+void PerfFrameTracker::startSampling()
+{
+	if (sampling)
+		return;
+	sampling = true;
+	obs_add_tick_callback(tick, this);
+}
+
+void PerfFrameTracker::stopSampling()
+{
+	if (!sampling)
+		return;
+	sampling = false;
+	obs_remove_tick_callback(tick, this);
+}
+
+void PerfFrameTracker::tick(void *data, float)
+{
+	static_cast<PerfFrameTracker *>(data)->sampleFrame();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "obs-module.h"
+#include <QList>
+#include <QMetaObject>
+#include <QObject>
+#include <util/source-profiler.h>
+
+/* Tick plus CPU and GPU render per frame, in ns. The profiler averages smooth a single slow frame away, so the peak
+   is taken from the maxima. */
+struct PerfFrameCost {
+	uint64_t frames = 0;
+	double sum = 0.0;
+	uint64_t peak = 0;
+
+	/* The tick is passed separately so callers can add the ticks of sources rendered through this one */
+	void add(uint64_t tick_avg, uint64_t tick_max, const profiler_result_t &perf);
+	uint64_t mean() const;
+};
+
+/* Newest records of a tracker, appended and read on the UI thread */
+template<typename Record> class PerfRecordRing {
+	QList<Record> records;
+	qsizetype capacity;
+
+public:
+	explicit PerfRecordRing(qsizetype capacity_) : capacity(capacity_) {}
+
+	void append(const Record &record)
+	{
+		records.append(record);
+		while (records.count() > capacity)
+			records.removeFirst();
+	}
+	const QList<Record> &list() const { return records; }
+};
+
+/* Calls sampleFrame() on the graphics thread once per frame */
+class PerfFrameTracker : public QObject {
+	Q_OBJECT
+
+	bool sampling = false;
+
+	static void tick(void *data, float seconds);
+
+protected:
+	virtual void sampleFrame() = 0;
+	/* Called last in the subclass constructor and first in its destructor, the graphics thread may otherwise call
+	   sampleFrame() on a subclass that is not constructed yet or already gone */
+	void startSampling();
+	void stopSampling();
+	/* Runs func on the UI thread, the queued call is dropped if the tracker is gone by then */
+	template<typename Func> void post(Func func) { QMetaObject::invokeMethod(this, func, Qt::QueuedConnection); }
+
+public:
+	PerfFrameTracker(QObject *parent = nullptr) : QObject(parent) {}
+	~PerfFrameTracker() override;
+};
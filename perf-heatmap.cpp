@@ -0,0 +1,260 @@
+
+#include "perf-heatmap.hpp"
+#include "perf-history.hpp"
+#include "source-profiler.hpp"
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <QWheelEvent>
+#include <util/platform.h>
+#include <algorithm>
+#include <iterator>
+
+#define HEATMAP_TILE_WIDTH 128
+#define HEATMAP_TILE_ROWS 16
+/* Tiles kept cached, about 8 KB each */
+#define HEATMAP_TILES 512
+#define HEATMAP_LABEL_WIDTH 160
+/* Tiles ending this long ago have all their samples, the refresh interval is at most 10 s */
+#define HEATMAP_SETTLE 11000
+
+/* Time per pixel column in ms */
+static const qint64 heatmap_scales[] = {1000, 5000, 10000, 30000, 60000, 300000};
+
+PerfHeatmapWidget::PerfHeatmapWidget(PerfTreeModel *m, QScrollBar *bar, QWidget *parent)
+	: QWidget(parent),
+	  model(m),
+	  scrollBar(bar)
+{
+	rowHeight = fontMetrics().height();
+	setMinimumSize(HEATMAP_LABEL_WIDTH + HEATMAP_TILE_WIDTH, rowHeight * 4);
+	connect(scrollBar, &QScrollBar::valueChanged, this, [this] { update(); });
+}
+
+PerfHeatmapWidget::~PerfHeatmapWidget()
+{
+	for (const auto &row : rows)
+		obs_weak_source_release(row.source);
+}
+
+bool PerfHeatmapWidget::EnumRow(void *data, obs_source_t *source)
+{
+	auto found = static_cast<QList<Row> *>(data);
+	found->append({obs_source_get_weak_source(source), QString::fromUtf8(obs_source_get_name(source))});
+	return true;
+}
+
+qint64 PerfHeatmapWidget::scale() const
+{
+	return heatmap_scales[scaleIndex];
+}
+
+qint64 PerfHeatmapWidget::rightEdge() const
+{
+	qint64 right = follow ? (qint64)(os_gettime_ns() / 1000000) : end;
+	// Whole columns only, so tiles land on the same pixels from one refresh to the next
+	return right - right % scale() + scale();
+}
+
+int PerfHeatmapWidget::visibleRows() const
+{
+	return std::max(0, (height() - rowHeight) / rowHeight);
+}
+
+void PerfHeatmapWidget::clearTiles()
+{
+	tiles.clear();
+	tileOrder.clear();
+}
+
+void PerfHeatmapWidget::refresh()
+{
+	QList<Row> found;
+	obs_enum_all_sources(EnumRow, &found);
+	std::sort(found.begin(), found.end(),
+		  [](const Row &a, const Row &b) { return a.name.compare(b.name, Qt::CaseInsensitive) < 0; });
+	bool changed = found.count() != rows.count();
+	for (int i = 0; !changed && i < found.count(); i++)
+		changed = found[i].source != rows[i].source || found[i].name != rows[i].name;
+	for (const auto &row : rows)
+		obs_weak_source_release(row.source);
+	rows = found;
+
+	if (changed || tileFrameTime != model->targetFrameTime()) {
+		clearTiles();
+		tileFrameTime = model->targetFrameTime();
+	} else {
+		// Only tiles still receiving samples are drawn again
+		for (auto it = tiles.begin(); it != tiles.end();) {
+			if (!it.value().complete) {
+				tileOrder.removeOne(it.key());
+				it = tiles.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+
+	scrollBar->setRange(0, std::max(0, (int)rows.count() - visibleRows()));
+	scrollBar->setPageStep(std::max(1, visibleRows()));
+	update();
+}
+
+const QImage &PerfHeatmapWidget::tile(int block, qint64 index)
+{
+	quint64 key = ((quint64)index << 20) | ((quint64)scaleIndex << 16) | (quint64)block;
+	auto it = tiles.find(key);
+	if (it != tiles.end())
+		return it.value().image;
+
+	qint64 length = scale() * HEATMAP_TILE_WIDTH;
+	qint64 from = index * length;
+	Tile t;
+	t.image = QImage(HEATMAP_TILE_WIDTH, HEATMAP_TILE_ROWS, QImage::Format_ARGB32);
+	t.image.fill(Qt::transparent);
+	t.complete = from + length + HEATMAP_SETTLE < (qint64)(os_gettime_ns() / 1000000);
+	QRgb low = palette().color(QPalette::Base).rgb();
+	QList<HistoryBucket> points;
+	for (int r = 0; r < HEATMAP_TILE_ROWS; r++) {
+		int row = block * HEATMAP_TILE_ROWS + r;
+		if (row >= rows.count())
+			break;
+		model->historySeries(rows[row].source, from, from + length, HEATMAP_TILE_WIDTH, points);
+		for (int x = 0; x < points.count(); x++) {
+			const auto &p = points.at(x);
+			if (p.empty() || tileFrameTime <= 0.0)
+				continue;
+			// Peaks, so short periodic spikes stay visible when zoomed out
+			auto color = ColorFormPercentage((double)p.max / tileFrameTime * 100.0);
+			t.image.setPixel(x, r, color.isValid() ? color.value<QColor>().rgb() : low);
+		}
+	}
+
+	while (tileOrder.count() >= HEATMAP_TILES)
+		tiles.remove(tileOrder.takeFirst());
+	tileOrder.append(key);
+	return tiles.insert(key, t).value().image;
+}
+
+void PerfHeatmapWidget::paintEvent(QPaintEvent *)
+{
+	QPainter painter(this);
+	int chartWidth = width() - HEATMAP_LABEL_WIDTH;
+	if (chartWidth <= 0 || rows.isEmpty())
+		return;
+
+	qint64 s = scale();
+	qint64 right = rightEdge();
+	qint64 left = right - (qint64)chartWidth * s;
+	qint64 length = s * HEATMAP_TILE_WIDTH;
+	int first = scrollBar->value();
+	int last = std::min((int)rows.count(), first + visibleRows() + 1);
+
+	painter.save();
+	painter.setClipRect(QRect(HEATMAP_LABEL_WIDTH, rowHeight, chartWidth, height() - rowHeight));
+	for (int block = first / HEATMAP_TILE_ROWS; block * HEATMAP_TILE_ROWS < last; block++) {
+		int y = rowHeight + (block * HEATMAP_TILE_ROWS - first) * rowHeight;
+		for (qint64 index = left / length; index * length < right; index++) {
+			int x = HEATMAP_LABEL_WIDTH + chartWidth - (int)((right - index * length) / s);
+			painter.drawImage(QRect(x, y, HEATMAP_TILE_WIDTH, HEATMAP_TILE_ROWS * rowHeight), tile(block, index));
+		}
+	}
+	painter.restore();
+
+	auto fm = painter.fontMetrics();
+	painter.setPen(palette().color(QPalette::WindowText));
+	for (int row = first; row < last; row++) {
+		QRect label(4, rowHeight + (row - first) * rowHeight, HEATMAP_LABEL_WIDTH - 8, rowHeight);
+		painter.drawText(label, Qt::AlignLeft | Qt::AlignVCenter,
+				 fm.elidedText(rows[row].name, Qt::ElideRight, label.width()));
+	}
+
+	// Time axis relative to now, a label about every 100 pixels
+	qint64 now = (qint64)(os_gettime_ns() / 1000000);
+	for (int x = chartWidth; x > 0; x -= 100) {
+		qint64 ago = now - (right - (qint64)(chartWidth - x) * s);
+		painter.drawLine(HEATMAP_LABEL_WIDTH + x - 1, 0, HEATMAP_LABEL_WIDTH + x - 1, rowHeight);
+		painter.drawText(QRect(HEATMAP_LABEL_WIDTH + x - 100, 0, 96, rowHeight), Qt::AlignRight | Qt::AlignVCenter,
+				 ago > s ? QString::fromUtf8("-") + history_span_text(ago)
+					 : QString::fromUtf8(obs_module_text("PerfViewer.HeatmapNow")));
+	}
+	painter.drawText(QRect(4, 0, HEATMAP_LABEL_WIDTH - 8, rowHeight), Qt::AlignLeft | Qt::AlignVCenter,
+			 QString::fromUtf8(obs_module_text("PerfViewer.HeatmapScale")).arg(history_span_text(s)));
+}
+
+void PerfHeatmapWidget::wheelEvent(QWheelEvent *event)
+{
+	int delta = event->angleDelta().y();
+	if (event->modifiers() & Qt::ControlModifier) {
+		int index = std::clamp(scaleIndex + (delta > 0 ? -1 : 1), 0, (int)std::size(heatmap_scales) - 1);
+		if (index != scaleIndex) {
+			// Zoom around the right edge
+			if (!follow)
+				end = rightEdge();
+			scaleIndex = index;
+			update();
+		}
+	} else {
+		scrollBar->setValue(scrollBar->value() - delta / 40);
+	}
+	event->accept();
+}
+
+void PerfHeatmapWidget::mousePressEvent(QMouseEvent *event)
+{
+	if (event->button() != Qt::LeftButton)
+		return;
+	dragX = event->pos().x();
+	dragEnd = rightEdge();
+}
+
+void PerfHeatmapWidget::mouseMoveEvent(QMouseEvent *event)
+{
+	if (dragX < 0)
+		return;
+	// Dragging to the right looks further back
+	qint64 right = dragEnd - (qint64)(event->pos().x() - dragX) * scale();
+	follow = right >= (qint64)(os_gettime_ns() / 1000000);
+	end = right;
+	update();
+}
+
+void PerfHeatmapWidget::mouseReleaseEvent(QMouseEvent *)
+{
+	dragX = -1;
+}
+
+void PerfHeatmapWidget::resizeEvent(QResizeEvent *)
+{
+	scrollBar->setRange(0, std::max(0, (int)rows.count() - visibleRows()));
+	scrollBar->setPageStep(std::max(1, visibleRows()));
+}
+
+PerfHeatmapDialog::PerfHeatmapDialog(QWidget *parent, PerfTreeModel *model) : QDialog(parent)
+{
+	setWindowTitle(QString::fromUtf8(obs_module_text("PerfViewer.Heatmap")));
+	setAttribute(Qt::WA_DeleteOnClose);
+	setSizeGripEnabled(true);
+	setGeometry(0, 0, 805, 500);
+
+	auto scrollBar = new QScrollBar(Qt::Vertical);
+	auto heatmap = new PerfHeatmapWidget(model, scrollBar);
+	auto chart = new QHBoxLayout();
+	chart->addWidget(heatmap);
+	chart->addWidget(scrollBar);
+
+	auto l = new QVBoxLayout();
+	l->addLayout(chart);
+	l->addWidget(new QLabel(QString::fromUtf8(obs_module_text("PerfViewer.HeatmapHint"))));
+	setLayout(l);
+
+	auto timer = new QTimer(this);
+	connect(timer, &QTimer::timeout, heatmap, &PerfHeatmapWidget::refresh);
+	timer->start(1000);
+	heatmap->refresh();
+	show();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "obs-module.h"
+#include <QDialog>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QWidget>
+
+class PerfTreeModel;
+class QScrollBar;
+
+/* Every source as a row and time as columns, colored by cost against the frame interval */
+class PerfHeatmapWidget : public QWidget {
+	Q_OBJECT
+
+	struct Row {
+		obs_weak_source_t *source;
+		QString name;
+	};
+
+	/* Rendered block of rows over an aligned time range, one pixel per row */
+	struct Tile {
+		QImage image;
+		/* Every sample of the time range has arrived */
+		bool complete;
+	};
+
+	PerfTreeModel *model = nullptr;
+	QScrollBar *scrollBar = nullptr;
+	QList<Row> rows;
+	QHash<quint64, Tile> tiles;
+	/* Keys of the cached tiles, oldest first */
+	QList<quint64> tileOrder;
+	double tileFrameTime = 0.0;
+	int rowHeight = 0;
+	int scaleIndex = 0;
+	/* Time at the right edge in ms, follows the newest sample when following */
+	qint64 end = 0;
+	bool follow = true;
+	int dragX = -1;
+	qint64 dragEnd = 0;
+
+	static bool EnumRow(void *data, obs_source_t *source);
+	qint64 scale() const;
+	qint64 rightEdge() const;
+	const QImage &tile(int block, qint64 index);
+	void clearTiles();
+	int visibleRows() const;
+
+public:
+	PerfHeatmapWidget(PerfTreeModel *model, QScrollBar *scrollBar, QWidget *parent = nullptr);
+	~PerfHeatmapWidget() override;
+
+public slots:
+	void refresh();
+
+protected:
+	void paintEvent(QPaintEvent *event) override;
+	void wheelEvent(QWheelEvent *event) override;
+	void mousePressEvent(QMouseEvent *event) override;
+	void mouseMoveEvent(QMouseEvent *event) override;
+	void mouseReleaseEvent(QMouseEvent *event) override;
+	void resizeEvent(QResizeEvent *event) override;
+};
+
+/* Non-modal heatmap of all sources, refreshed every second */
+class PerfHeatmapDialog : public QDialog {
+	Q_OBJECT
+
+public:
+	PerfHeatmapDialog(QWidget *parent, PerfTreeModel *model);
+};
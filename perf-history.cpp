@@ -0,0 +1,228 @@
+
+#include "perf-history.hpp"
+#include "source-profiler.hpp"
+#include <QPainter>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <QWheelEvent>
+#include <util/platform.h>
+#include <algorithm>
+
+static const struct {
+	/* Bucket length in ms */
+	qint64 length;
+	int size;
+	int offset;
+} history_levels[HISTORY_LEVELS] = {
+	{1000, 600, 0},
+	{10000, 720, 600},
+	{60000, 1440, 600 + 720},
+};
+
+/* Shortest and longest span the timeline zooms to, in ms */
+#define TIMELINE_MIN_SPAN 60000
+#define TIMELINE_MAX_SPAN (24 * 3600000)
+
+void PerfHistory::add(qint64 time, float value)
+{
+	if (first < 0)
+		first = time;
+	for (int l = 0; l < HISTORY_LEVELS; l++) {
+		const auto &def = history_levels[l];
+		auto &level = levels[l];
+		qint64 index = time / def.length;
+		if (index < level.current)
+			continue;
+		if (index != level.current) {
+			// Buckets passed without samples, e.g. while the refresh interval is longer than the bucket
+			if (level.current >= 0) {
+				for (qint64 i = level.current + 1; i < index && i <= level.current + def.size; i++)
+					buckets[def.offset + i % def.size] = HistoryBucket();
+			}
+			level.current = index;
+			level.min = level.max = value;
+			level.sum = 0.0;
+			level.count = 0;
+		}
+		level.min = std::min(level.min, value);
+		level.max = std::max(level.max, value);
+		level.sum += value;
+		level.count++;
+		// The bucket being filled is kept up to date so the newest point is never missing
+		auto &bucket = buckets[def.offset + index % def.size];
+		bucket.min = level.min;
+		bucket.avg = (float)(level.sum / level.count);
+		bucket.max = level.max;
+	}
+}
+
+qint64 PerfHistory::series(qint64 from, qint64 to, int count, QList<HistoryBucket> &points) const
+{
+	points.clear();
+	if (count <= 0 || to <= from || first < 0)
+		return 0;
+	int l = 0;
+	while (l < HISTORY_LEVELS - 1) {
+		const auto &def = history_levels[l];
+		qint64 oldest = (levels[l].current - def.size + 1) * def.length;
+		if (std::max(from, first) >= oldest)
+			break;
+		l++;
+	}
+	const auto &def = history_levels[l];
+	const auto &level = levels[l];
+	points.reserve(count);
+	for (int i = 0; i < count; i++) {
+		qint64 t0 = from + (to - from) * i / count;
+		qint64 t1 = from + (to - from) * (i + 1) / count;
+		// Buckets before the first sample were never written, those points stay empty
+		qint64 b0 = std::max({t0 / def.length, level.current - def.size + 1, first / def.length, (qint64)0});
+		qint64 b1 = std::min(std::max(t0 / def.length, (t1 - 1) / def.length), level.current);
+		HistoryBucket point;
+		double sum = 0.0;
+		int n = 0;
+		for (qint64 b = b0; b <= b1; b++) {
+			const auto &bucket = buckets[def.offset + b % def.size];
+			if (bucket.empty())
+				continue;
+			point.min = n ? std::min(point.min, bucket.min) : bucket.min;
+			point.max = n ? std::max(point.max, bucket.max) : bucket.max;
+			sum += bucket.avg;
+			n++;
+		}
+		if (n)
+			point.avg = (float)(sum / n);
+		points.append(point);
+	}
+	return def.length;
+}
+
+PerfTimelineWidget::PerfTimelineWidget(QWidget *parent) : QWidget(parent)
+{
+	setMinimumHeight(80);
+}
+
+void PerfTimelineWidget::setPoints(const QList<HistoryBucket> &p, qint64 bucketLength, double frame)
+{
+	points = p;
+	bucket = bucketLength;
+	frameTime = frame;
+	update();
+}
+
+void PerfTimelineWidget::wheelEvent(QWheelEvent *event)
+{
+	qint64 s = event->angleDelta().y() > 0 ? span / 2 : span * 2;
+	s = std::clamp(s, (qint64)TIMELINE_MIN_SPAN, (qint64)TIMELINE_MAX_SPAN);
+	if (s != span) {
+		span = s;
+		emit spanChanged();
+	}
+	event->accept();
+}
+
+QString history_span_text(qint64 ms)
+{
+	if (ms >= 3600000)
+		return QString::asprintf("%.01f h", (double)ms / 3600000.0);
+	if (ms >= 60000)
+		return QString::asprintf("%.01f min", (double)ms / 60000.0);
+	return QString::asprintf("%lld s", ms / 1000);
+}
+
+void PerfTimelineWidget::paintEvent(QPaintEvent *)
+{
+	QPainter painter(this);
+	auto fm = painter.fontMetrics();
+	int textHeight = fm.height() + 4;
+	int chartHeight = height() - textHeight;
+	if (chartHeight <= 0 || points.isEmpty())
+		return;
+
+	float scale = (float)frameTime;
+	for (const auto &p : points) {
+		if (!p.empty())
+			scale = std::max(scale, p.max);
+	}
+	if (scale <= 0.0f)
+		return;
+
+	// https://coolors.co/palette/5b6273-718cdc-eabc48-e85e75
+	const QColor bandColor(91, 98, 115);
+	const QColor avgColor(113, 140, 220);
+
+	double step = (double)width() / (double)points.count();
+	auto y = [&](float v) { return chartHeight - 1 - (int)(v / scale * (float)(chartHeight - 1)); };
+	int prevX = -1, prevY = 0;
+	for (int i = 0; i < points.count(); i++) {
+		const auto &p = points.at(i);
+		if (p.empty()) {
+			prevX = -1;
+			continue;
+		}
+		int x = (int)(step * i);
+		int w = std::max(1, (int)(step * (i + 1)) - x);
+		painter.fillRect(x, y(p.max), w, std::max(1, y(p.min) - y(p.max)), bandColor);
+		painter.setPen(avgColor);
+		if (prevX >= 0)
+			painter.drawLine(prevX, prevY, x, y(p.avg));
+		prevX = x;
+		prevY = y(p.avg);
+	}
+
+	// Frame interval line: averages above it miss frames
+	if (frameTime > 0.0) {
+		painter.setPen(palette().color(QPalette::WindowText));
+		painter.drawLine(0, y((float)frameTime), width(), y((float)frameTime));
+	}
+
+	painter.setPen(palette().color(QPalette::WindowText));
+	painter.drawText(QRect(4, chartHeight, width() - 8, textHeight), Qt::AlignLeft | Qt::AlignVCenter,
+			 QString::fromUtf8(obs_module_text("PerfViewer.HistorySpan"))
+				 .arg(history_span_text(span))
+				 .arg(history_span_text(bucket))
+				 .arg(QString::asprintf("%.02f", scale)));
+}
+
+PerfHistoryDialog::PerfHistoryDialog(QWidget *parent, PerfTreeModel *m, obs_source_t *s)
+	: QDialog(parent),
+	  model(m),
+	  source(obs_source_get_weak_source(s))
+{
+	setWindowTitle(QString::fromUtf8(obs_module_text("PerfViewer.History")) + " - " +
+		       QString::fromUtf8(obs_source_get_name(s)));
+	setAttribute(Qt::WA_DeleteOnClose);
+	setSizeGripEnabled(true);
+	setGeometry(0, 0, 805, 200);
+
+	timeline = new PerfTimelineWidget();
+	auto l = new QVBoxLayout();
+	l->addWidget(timeline);
+	setLayout(l);
+	connect(timeline, &PerfTimelineWidget::spanChanged, this, &PerfHistoryDialog::refresh);
+
+	auto timer = new QTimer(this);
+	connect(timer, &QTimer::timeout, this, &PerfHistoryDialog::refresh);
+	timer->start(1000);
+	refresh();
+	show();
+}
+
+PerfHistoryDialog::~PerfHistoryDialog()
+{
+	obs_weak_source_release(source);
+}
+
+void PerfHistoryDialog::refresh()
+{
+	obs_source_t *s = obs_weak_source_get_source(source);
+	if (!s) {
+		close();
+		return;
+	}
+	obs_source_release(s);
+	QList<HistoryBucket> points;
+	qint64 now = (qint64)(os_gettime_ns() / 1000000);
+	qint64 bucket = model->historySeries(source, now - timeline->getSpan(), now, std::max(1, timeline->width()), points);
+	timeline->setPoints(points, bucket, model->targetFrameTime());
+}
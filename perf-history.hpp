@@ -0,0 +1,84 @@
+#pragma once
+
+#include "obs-module.h"
+#include <QDialog>
+#include <QList>
+#include <QWidget>
+
+/* Buckets of 1 s for 10 minutes, 10 s for 2 hours and 1 minute for 24 hours */
+#define HISTORY_LEVELS 3
+#define HISTORY_BUCKETS (600 + 720 + 1440)
+
+struct HistoryBucket {
+	float min = 0.0f;
+	/* Negative when nothing was sampled in the bucket */
+	float avg = -1.0f;
+	float max = 0.0f;
+
+	bool empty() const { return avg < 0.0f; }
+};
+
+/* Min/avg/max rollups of one value at several resolutions, updated per sample in a fixed amount of memory */
+class PerfHistory {
+	struct Level {
+		/* Bucket being filled, as time / bucket length */
+		qint64 current = -1;
+		float min = 0.0f;
+		float max = 0.0f;
+		double sum = 0.0;
+		int count = 0;
+	};
+
+	Level levels[HISTORY_LEVELS];
+	HistoryBucket buckets[HISTORY_BUCKETS];
+	qint64 first = -1;
+
+public:
+	/* Time in ms on a monotonic clock */
+	void add(qint64 time, float value);
+	/* Points over [from, to) from the finest level that reaches back to from, returns that level's bucket length in ms */
+	qint64 series(qint64 from, qint64 to, int count, QList<HistoryBucket> &points) const;
+};
+
+/* Short text for a time span, like "10.0 min" */
+QString history_span_text(qint64 ms);
+
+class PerfTreeModel;
+
+/* Band of min to max with the average over a zoomable time span */
+class PerfTimelineWidget : public QWidget {
+	Q_OBJECT
+
+	QList<HistoryBucket> points;
+	qint64 span = 600000;
+	qint64 bucket = 0;
+	double frameTime = 0.0;
+
+public:
+	PerfTimelineWidget(QWidget *parent = nullptr);
+	qint64 getSpan() const { return span; }
+	void setPoints(const QList<HistoryBucket> &p, qint64 bucketLength, double frame);
+
+signals:
+	void spanChanged();
+
+protected:
+	void paintEvent(QPaintEvent *event) override;
+	void wheelEvent(QWheelEvent *event) override;
+};
+
+/* Non-modal history of one source, refreshed every second */
+class PerfHistoryDialog : public QDialog {
+	Q_OBJECT
+
+	PerfTreeModel *model = nullptr;
+	obs_weak_source_t *source = nullptr;
+	PerfTimelineWidget *timeline = nullptr;
+
+public:
+	PerfHistoryDialog(QWidget *parent, PerfTreeModel *model, obs_source_t *source);
+	~PerfHistoryDialog() override;
+
+public slots:
+	void refresh();
+};
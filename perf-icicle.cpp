@@ -0,0 +1,264 @@
+
+#include "perf-icicle.hpp"
+#include "perf-util.hpp"
+#include "source-profiler.hpp"
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QHelpEvent>
+#include <QLabel>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QTimer>
+#include <QToolTip>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <cmath>
+
+/* Part of the remaining distance to the newest value covered per animation frame */
+#define ICICLE_EASING 0.3
+#define ICICLE_FRAME_MS 30
+
+PerfIcicleWidget::PerfIcicleWidget(PerfTreeModel *m, QWidget *parent)
+	: QWidget(parent),
+	  model(m)
+{
+	setMinimumSize(400, 200);
+	setMouseTracking(true);
+	animation = new QTimer(this);
+	animation->setInterval(ICICLE_FRAME_MS);
+	connect(animation, &QTimer::timeout, this, [this] {
+		if (!ease(root, ICICLE_EASING))
+			animation->stop();
+		update();
+	});
+	connect(model, &PerfTreeModel::updated, this, &PerfIcicleWidget::sample);
+	connect(model, &QAbstractItemModel::modelReset, this, &PerfIcicleWidget::invalidate);
+	connect(model, &QAbstractItemModel::rowsInserted, this, &PerfIcicleWidget::invalidate);
+	connect(model, &QAbstractItemModel::rowsRemoved, this, &PerfIcicleWidget::invalidate);
+	sample();
+}
+
+void PerfIcicleWidget::setMetric(enum Metric m)
+{
+	metric = m;
+	sample();
+}
+
+void PerfIcicleWidget::build(IcicleNode &node, const QModelIndex &parent)
+{
+	int rows = model->rowCount(parent);
+	for (int row = 0; row < rows; row++) {
+		auto index = model->index(row, 0, parent);
+		IcicleNode child;
+		child.item = static_cast<PerfTreeItem *>(index.internalPointer());
+		child.name = model->data(index, Qt::DisplayRole).toString();
+		build(child, index);
+		node.children.append(child);
+	}
+}
+
+void PerfIcicleWidget::sync(IcicleNode &node)
+{
+	double sum = 0.0;
+	for (auto &child : node.children) {
+		sync(child);
+		sum += child.value;
+	}
+	if (!node.item) {
+		node.value = sum;
+		return;
+	}
+	auto perf = node.item->result();
+	uint64_t ns = total_cost(perf);
+	if (metric == METRIC_CPU)
+		ns = perf->tick_avg + perf->render_sum;
+	else if (metric == METRIC_GPU)
+		ns = perf->render_gpu_sum;
+	node.value = (double)ns / 1000000.0;
+}
+
+bool PerfIcicleWidget::ease(IcicleNode &node, double factor)
+{
+	bool moving = false;
+	for (auto &child : node.children)
+		moving |= ease(child, factor);
+	if (std::abs(node.value - node.shown) < 0.001) {
+		node.shown = node.value;
+		return moving;
+	}
+	node.shown += (node.value - node.shown) * factor;
+	return true;
+}
+
+void PerfIcicleWidget::sample()
+{
+	if (dirty) {
+		// Only a change of the tree's rows rebuilds the nodes, passes just update their values
+		root = IcicleNode();
+		root.name = QString::fromUtf8(obs_module_text("PerfViewer.Total"));
+		build(root, QModelIndex());
+		hits.clear();
+		dirty = false;
+		// New nodes start at their current size instead of growing from nothing
+		sync(root);
+		ease(root, 1.0);
+		update();
+		return;
+	}
+	sync(root);
+	if (isVisible() && !animation->isActive())
+		animation->start();
+}
+
+const IcicleNode *PerfIcicleWidget::zoomed() const
+{
+	const IcicleNode *node = &root;
+	for (const auto &name : zoomPath) {
+		const IcicleNode *next = nullptr;
+		for (const auto &child : node->children) {
+			if (child.name == name) {
+				next = &child;
+				break;
+			}
+		}
+		if (!next)
+			break;
+		node = next;
+	}
+	return node;
+}
+
+static bool node_path(const IcicleNode &from, const IcicleNode *target, QStringList &path)
+{
+	if (&from == target)
+		return true;
+	for (const auto &child : from.children) {
+		path.append(child.name);
+		if (node_path(child, target, path))
+			return true;
+		path.removeLast();
+	}
+	return false;
+}
+
+void PerfIcicleWidget::drawNode(QPainter &painter, const IcicleNode &node, int x, int w, int depth)
+{
+	int rowHeight = painter.fontMetrics().height() + 6;
+	if (w < 1 || (depth + 1) * rowHeight > height())
+		return;
+	QRect rect(x, depth * rowHeight, w, rowHeight);
+	double frame = model->targetFrameTime();
+	auto color = frame > 0.0 ? ColorFormPercentage(node.shown / frame * 100.0) : QVariant();
+	painter.fillRect(rect, color.isValid() ? color.value<QColor>() : palette().color(QPalette::Base));
+	painter.setPen(palette().color(QPalette::Mid));
+	painter.drawRect(rect.adjusted(0, 0, -1, -1));
+	if (w > 24) {
+		painter.setPen(palette().color(QPalette::Text));
+		auto text = node.name + QString::asprintf(" %.02f ms", node.shown);
+		QRect textRect = rect.adjusted(3, 0, -3, 0);
+		painter.drawText(textRect, Qt::AlignLeft | Qt::AlignVCenter,
+				 painter.fontMetrics().elidedText(text, Qt::ElideRight, textRect.width()));
+	}
+	hits.append(qMakePair(rect, &node));
+
+	// Whatever the children do not cover is the node's own cost
+	double sum = 0.0;
+	for (const auto &child : node.children)
+		sum += child.shown;
+	double total = std::max(node.shown, sum);
+	if (total <= 0.0)
+		return;
+	double cx = x;
+	for (const auto &child : node.children) {
+		double cw = (double)w * child.shown / total;
+		drawNode(painter, child, (int)std::lround(cx), (int)std::lround(cx + cw) - (int)std::lround(cx), depth + 1);
+		cx += cw;
+	}
+}
+
+void PerfIcicleWidget::paintEvent(QPaintEvent *)
+{
+	QPainter painter(this);
+	hits.clear();
+	drawNode(painter, *zoomed(), 0, width(), 0);
+}
+
+const IcicleNode *PerfIcicleWidget::nodeAt(const QPoint &pos) const
+{
+	for (const auto &hit : hits) {
+		if (hit.first.contains(pos))
+			return hit.second;
+	}
+	return nullptr;
+}
+
+void PerfIcicleWidget::mousePressEvent(QMouseEvent *event)
+{
+	if (event->button() == Qt::RightButton) {
+		zoomPath.clear();
+		update();
+		return;
+	}
+	if (event->button() != Qt::LeftButton)
+		return;
+	auto node = nodeAt(event->pos());
+	if (!node)
+		return;
+	if (node == zoomed()) {
+		// The top bar steps back out
+		if (!zoomPath.isEmpty())
+			zoomPath.removeLast();
+	} else if (!node->children.isEmpty()) {
+		QStringList path;
+		if (node_path(root, node, path))
+			zoomPath = path;
+	}
+	update();
+}
+
+bool PerfIcicleWidget::event(QEvent *event)
+{
+	if (event->type() != QEvent::ToolTip)
+		return QWidget::event(event);
+	auto help = static_cast<QHelpEvent *>(event);
+	auto node = nodeAt(help->pos());
+	if (!node) {
+		QToolTip::hideText();
+		return true;
+	}
+	double frame = model->targetFrameTime();
+	QToolTip::showText(help->globalPos(),
+			   node->name + QString::asprintf("\n%.02f ms (%.01f%%)", node->value,
+							  frame > 0.0 ? node->value / frame * 100.0 : 0.0),
+			   this);
+	return true;
+}
+
+PerfIcicleDialog::PerfIcicleDialog(QWidget *parent, PerfTreeModel *model) : QDialog(parent)
+{
+	setWindowTitle(QString::fromUtf8(obs_module_text("PerfViewer.Icicle")));
+	setAttribute(Qt::WA_DeleteOnClose);
+	setSizeGripEnabled(true);
+	setGeometry(0, 0, 805, 300);
+
+	auto icicle = new PerfIcicleWidget(model);
+	auto metricBox = new QComboBox();
+	metricBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.TotalPercentage")), PerfIcicleWidget::METRIC_TOTAL);
+	metricBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.CpuPercentage")), PerfIcicleWidget::METRIC_CPU);
+#ifndef __APPLE__
+	metricBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.GpuPercentage")), PerfIcicleWidget::METRIC_GPU);
+#endif
+	connect(metricBox, &QComboBox::currentIndexChanged, this, [icicle, metricBox] {
+		icicle->setMetric((enum PerfIcicleWidget::Metric)metricBox->currentData().toInt());
+	});
+
+	auto bar = new QHBoxLayout();
+	bar->addWidget(metricBox);
+	bar->addWidget(new QLabel(QString::fromUtf8(obs_module_text("PerfViewer.IcicleHint"))), 1);
+
+	auto l = new QVBoxLayout();
+	l->addWidget(icicle, 1);
+	l->addLayout(bar);
+	setLayout(l);
+	show();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "obs-module.h"
+#include <QDialog>
+#include <QList>
+#include <QPair>
+#include <QRect>
+#include <QStringList>
+#include <QWidget>
+
+class PerfTreeModel;
+class PerfTreeItem;
+class QModelIndex;
+class QTimer;
+
+/* Row of the profiler tree with its cost in ms, eased towards the newest pass for drawing */
+struct IcicleNode {
+	PerfTreeItem *item = nullptr;
+	QString name;
+	double value = 0.0;
+	double shown = 0.0;
+	QList<IcicleNode> children;
+};
+
+/* The profiler tree as nested bars, each as wide as its cost */
+class PerfIcicleWidget : public QWidget {
+	Q_OBJECT
+
+public:
+	enum Metric { METRIC_TOTAL, METRIC_CPU, METRIC_GPU };
+
+private:
+	PerfTreeModel *model = nullptr;
+	IcicleNode root;
+	/* Tree rows were added or removed since the nodes were built */
+	bool dirty = true;
+	enum Metric metric = METRIC_TOTAL;
+	/* Names from the root to the zoomed node, kept by name so it survives a rebuild */
+	QStringList zoomPath;
+	QTimer *animation = nullptr;
+	/* Node rectangles of the last paint, for clicks and tooltips */
+	QList<QPair<QRect, const IcicleNode *>> hits;
+
+	void build(IcicleNode &node, const QModelIndex &parent);
+	void sync(IcicleNode &node);
+	bool ease(IcicleNode &node, double factor);
+	const IcicleNode *zoomed() const;
+	void drawNode(QPainter &painter, const IcicleNode &node, int x, int w, int depth);
+	const IcicleNode *nodeAt(const QPoint &pos) const;
+
+public:
+	PerfIcicleWidget(PerfTreeModel *model, QWidget *parent = nullptr);
+
+	void setMetric(enum Metric m);
+
+public slots:
+	void sample();
+	void invalidate() { dirty = true; }
+
+protected:
+	void paintEvent(QPaintEvent *event) override;
+	void mousePressEvent(QMouseEvent *event) override;
+	bool event(QEvent *event) override;
+};
+
+/* Non-modal icicle chart of the profiler tree, updated with every pass */
+class PerfIcicleDialog : public QDialog {
+	Q_OBJECT
+
+public:
+	PerfIcicleDialog(QWidget *parent, PerfTreeModel *model);
+};
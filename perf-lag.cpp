@@ -0,0 +1,131 @@
+
+#include "perf-lag.hpp"
+#include "source-profiler.hpp"
+#include <util/source-profiler.h>
+#include <algorithm>
+#include <cmath>
+
+/* Culprits listed, best correlated first */
+#define LAG_CULPRITS 25
+/* Passes with lag needed before a correlation means anything */
+#define LAG_MIN_EVENTS 2
+
+PerfLagTracker::PerfLagTracker(PerfTreeModel *m, QObject *parent) : QObject(parent), model(m)
+{
+	lagged = obs_get_lagged_frames();
+	skipped = video_output_get_skipped_frames(obs_get_video());
+}
+
+PerfLagTracker::~PerfLagTracker()
+{
+	for (auto it = sources.begin(); it != sources.end(); ++it)
+		obs_weak_source_release(it.key());
+}
+
+void PerfLagTracker::sample()
+{
+	pass++;
+	uint32_t l = obs_get_lagged_frames();
+	uint32_t s = video_output_get_skipped_frames(obs_get_video());
+	// Counters restart when video is reset
+	events[pass % LAG_WINDOW] = (double)((l >= lagged ? l - lagged : 0) + (s >= skipped ? s - skipped : 0));
+	lagged = l;
+	skipped = s;
+
+	// The model's samples of this pass, quiet sources repeat their last one
+	model->forEachSample([this](obs_weak_source_t *weak, const PerfSourceSample &sample) {
+		if (sample.kind == OBS_SOURCE_TYPE_SCENE || !sample.active)
+			return;
+		auto it = sources.find(weak);
+		if (it == sources.end()) {
+			obs_source_t *source = obs_weak_source_get_source(weak);
+			if (!source)
+				return;
+			obs_weak_source_addref(weak);
+			it = sources.insert(weak, SourceHistory());
+			it.value().first_pass = pass;
+			it.value().type = QString::fromUtf8(obs_source_get_display_name(obs_source_get_unversioned_id(source)));
+			obs_source_release(source);
+		}
+		auto &history = it.value();
+		// Passes the source was inactive in count as no spike
+		for (uint64_t p = std::max(history.last_pass + 1, pass > LAG_WINDOW ? pass - LAG_WINDOW : 0); p < pass; p++)
+			history.spikes[p % LAG_WINDOW] = 0.0;
+		const auto &perf = sample.exclusive;
+		history.spikes[pass % LAG_WINDOW] = (double)(perf.tick_max + perf.render_max + perf.render_gpu_max);
+		history.last_pass = pass;
+	});
+
+	for (auto it = sources.begin(); it != sources.end();) {
+		if (pass - it.value().last_pass >= LAG_WINDOW) {
+			obs_weak_source_release(it.key());
+			it = sources.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+QList<QStringList> PerfLagTracker::culprits() const
+{
+	uint64_t start = pass >= LAG_WINDOW ? pass - LAG_WINDOW + 1 : 1;
+	int eventPasses = 0;
+	for (uint64_t p = start; p <= pass; p++) {
+		if (events[p % LAG_WINDOW] > 0.0)
+			eventPasses++;
+	}
+	if (eventPasses < LAG_MIN_EVENTS)
+		return {};
+
+	QList<QPair<double, QStringList>> scored;
+	for (auto it = sources.cbegin(); it != sources.cend(); ++it) {
+		const auto &history = it.value();
+		// Pearson correlation of spikes and bad frames over the passes the source was seen in
+		uint64_t from = std::max(start, history.first_pass);
+		double n = 0, sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+		double lagSpike = 0, lagCount = 0, calmSpike = 0, calmCount = 0;
+		for (uint64_t p = from; p <= pass; p++) {
+			double x = p <= history.last_pass ? history.spikes[p % LAG_WINDOW] : 0.0;
+			double y = events[p % LAG_WINDOW];
+			n++;
+			sx += x;
+			sy += y;
+			sxx += x * x;
+			syy += y * y;
+			sxy += x * y;
+			if (y > 0.0) {
+				lagSpike += x;
+				lagCount++;
+			} else {
+				calmSpike += x;
+				calmCount++;
+			}
+		}
+		double varX = n * sxx - sx * sx;
+		double varY = n * syy - sy * sy;
+		if (n < 2 || varX <= 0.0 || varY <= 0.0 || !lagCount)
+			continue;
+		double score = (n * sxy - sx * sy) / std::sqrt(varX * varY);
+		if (score <= 0.0)
+			continue;
+		obs_source_t *source = obs_weak_source_get_source(it.key());
+		if (!source)
+			continue;
+		QString name = QString::fromUtf8(obs_source_get_name(source));
+		obs_source_release(source);
+		scored.append(qMakePair(score, QStringList{name, history.type, QString::asprintf("%.02f", score),
+							   QString::asprintf("%.02f", lagSpike / lagCount / 1000000.0),
+							   calmCount ? QString::asprintf("%.02f", calmSpike / calmCount / 1000000.0)
+								     : QString(),
+							   QString::number(eventPasses)}));
+	}
+	std::sort(scored.begin(), scored.end(),
+		  [](const QPair<double, QStringList> &a, const QPair<double, QStringList> &b) { return a.first > b.first; });
+	QList<QStringList> rows;
+	for (const auto &entry : scored) {
+		if (rows.count() >= LAG_CULPRITS)
+			break;
+		rows.append(entry.second);
+	}
+	return rows;
+}
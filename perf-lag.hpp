@@ -0,0 +1,42 @@
+#pragma once
+
+#include "obs-module.h"
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+
+class PerfTreeModel;
+
+/* Passes of the sliding window that spikes are correlated over */
+#define LAG_WINDOW 120
+
+/* Correlates per-source spikes with lagged and skipped frames over a sliding window */
+class PerfLagTracker : public QObject {
+	Q_OBJECT
+
+	struct SourceHistory {
+		QString type;
+		/* tick_max + render_max + render_gpu_max per pass in ns, indexed by pass % LAG_WINDOW */
+		double spikes[LAG_WINDOW] = {};
+		uint64_t first_pass = 0;
+		uint64_t last_pass = 0;
+	};
+
+	PerfTreeModel *model;
+	QHash<obs_weak_source_t *, SourceHistory> sources;
+	/* Lagged plus skipped frames per pass */
+	double events[LAG_WINDOW] = {};
+	uint64_t pass = 0;
+	uint32_t lagged = 0;
+	uint32_t skipped = 0;
+
+public:
+	PerfLagTracker(PerfTreeModel *model, QObject *parent = nullptr);
+	~PerfLagTracker() override;
+
+	QList<QStringList> culprits() const;
+
+public slots:
+	void sample();
+};
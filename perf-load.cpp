@@ -0,0 +1,139 @@
+
+#include "perf-load.hpp"
+#include <QMetaObject>
+#include <util/platform.h>
+#include <util/source-profiler.h>
+#include <algorithm>
+
+/* Sources not rendered this long after the collection loaded are reported as not rendered */
+#define LOAD_WATCH_TIMEOUT 10000000000ULL
+
+PerfLoadProfiler::PerfLoadProfiler(QObject *parent) : QObject(parent)
+{
+	signal_handler_connect(obs_get_signal_handler(), "source_create", source_create, this);
+	obs_frontend_add_event_callback(frontend_event, this);
+	obs_add_tick_callback(tick, this);
+}
+
+PerfLoadProfiler::~PerfLoadProfiler()
+{
+	obs_remove_tick_callback(tick, this);
+	obs_frontend_remove_event_callback(frontend_event, this);
+	signal_handler_disconnect(obs_get_signal_handler(), "source_create", source_create, this);
+	for (auto &loaded : sources)
+		obs_weak_source_release(loaded.source);
+}
+
+void PerfLoadProfiler::source_create(void *data, calldata_t *cd)
+{
+	auto profiler = static_cast<PerfLoadProfiler *>(data);
+	QMutexLocker locker(&profiler->mutex);
+	if (!profiler->loading)
+		return;
+	obs_source_t *source = static_cast<obs_source_t *>(calldata_ptr(cd, "source"));
+	LoadedSource loaded;
+	loaded.source = obs_source_get_weak_source(source);
+	loaded.name = QString::fromUtf8(obs_source_get_name(source));
+	loaded.type = QString::fromUtf8(obs_source_get_display_name(obs_source_get_unversioned_id(source)));
+	loaded.created = os_gettime_ns() - profiler->changing;
+	loaded.first_tick = 0;
+	loaded.first_render = 0;
+	profiler->sources.append(loaded);
+}
+
+void PerfLoadProfiler::stopWatching()
+{
+	watching = false;
+	for (auto &loaded : sources) {
+		obs_weak_source_release(loaded.source);
+		loaded.source = nullptr;
+	}
+}
+
+void PerfLoadProfiler::frontend_event(enum obs_frontend_event event, void *data)
+{
+	auto profiler = static_cast<PerfLoadProfiler *>(data);
+	QMutexLocker locker(&profiler->mutex);
+	uint64_t now = os_gettime_ns();
+	if (event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGING) {
+		profiler->stopWatching();
+		profiler->sources.clear();
+		profiler->collection.clear();
+		profiler->loading = true;
+		profiler->watching = true;
+		profiler->changing = now;
+		profiler->changed = 0;
+	} else if (event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED && profiler->loading) {
+		profiler->loading = false;
+		profiler->changed = now;
+		char *name = obs_frontend_get_current_scene_collection();
+		profiler->collection = QString::fromUtf8(name);
+		bfree(name);
+	}
+}
+
+void PerfLoadProfiler::tick(void *data, float)
+{
+	auto profiler = static_cast<PerfLoadProfiler *>(data);
+	QMutexLocker locker(&profiler->mutex);
+	if (!profiler->watching)
+		return;
+	uint64_t now = os_gettime_ns();
+	bool pending = false;
+	for (auto &loaded : profiler->sources) {
+		if (!loaded.source || (loaded.first_tick && loaded.first_render))
+			continue;
+		obs_source_t *source = obs_weak_source_get_source(loaded.source);
+		profiler_result_t perf;
+		if (source && source_profiler_fill_result(source, &perf)) {
+			// The profiler keeps a result once the source went through a frame, sources without
+			// video_tick never report a tick time
+			if (!loaded.first_tick)
+				loaded.first_tick = now - profiler->changing;
+			if (!loaded.first_render && (perf.render_avg || perf.render_gpu_avg))
+				loaded.first_render = now - profiler->changing;
+		}
+		obs_source_release(source);
+		if (!loaded.first_render)
+			pending = true;
+	}
+	if (profiler->loading || (pending && now - profiler->changed < LOAD_WATCH_TIMEOUT))
+		return;
+	profiler->stopWatching();
+	QMetaObject::invokeMethod(profiler, [profiler] { emit profiler->loadFinished(); }, Qt::QueuedConnection);
+}
+
+QString PerfLoadProfiler::title() const
+{
+	QMutexLocker locker(&mutex);
+	auto title = QString::fromUtf8(obs_module_text("PerfViewer.CollectionLoad"));
+	if (!collection.isEmpty())
+		title += " - " + collection;
+	if (changed)
+		title += QString::asprintf(" (%.0f ms)", (double)(changed - changing) / 1000000.0);
+	return title;
+}
+
+QList<QStringList> PerfLoadProfiler::results() const
+{
+	QList<LoadedSource> sorted;
+	{
+		QMutexLocker locker(&mutex);
+		sorted = sources;
+	}
+	// Slowest to first render first, sources that never rendered last
+	std::stable_sort(sorted.begin(), sorted.end(), [](const LoadedSource &a, const LoadedSource &b) {
+		if (!a.first_render || !b.first_render)
+			return a.first_render > b.first_render;
+		return a.first_render - a.created > b.first_render - b.created;
+	});
+	auto ms = [](uint64_t ns) { return QString::asprintf("%.0f", (double)ns / 1000000.0); };
+	QList<QStringList> rows;
+	for (const auto &loaded : sorted) {
+		rows.append(QStringList{loaded.name, loaded.type, ms(loaded.created),
+					loaded.first_tick ? ms(loaded.first_tick - loaded.created) : QString(),
+					loaded.first_render ? ms(loaded.first_render - loaded.created)
+							    : QString::fromUtf8(obs_module_text("PerfViewer.NotRendered"))});
+	}
+	return rows;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "obs-module.h"
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <obs-frontend-api.h>
+
+/* Profiles scene collection loads: creation, first tick and first render of every source */
+class PerfLoadProfiler : public QObject {
+	Q_OBJECT
+
+	struct LoadedSource {
+		obs_weak_source_t *source;
+		QString name;
+		QString type;
+		/* ns after the collection started changing, 0 while not seen */
+		uint64_t created;
+		uint64_t first_tick;
+		uint64_t first_render;
+	};
+
+	/* Guards everything below, sources are created on the UI thread and watched on the graphics thread */
+	mutable QMutex mutex;
+	QList<LoadedSource> sources;
+	QString collection;
+	bool loading = false;
+	bool watching = false;
+	uint64_t changing = 0;
+	uint64_t changed = 0;
+
+	void stopWatching();
+
+	static void source_create(void *data, calldata_t *cd);
+	static void frontend_event(enum obs_frontend_event event, void *data);
+	static void tick(void *data, float seconds);
+
+public:
+	PerfLoadProfiler(QObject *parent = nullptr);
+	~PerfLoadProfiler() override;
+
+	QString title() const;
+	QList<QStringList> results() const;
+
+signals:
+	/* Emitted once every source rendered or the watch timed out */
+	void loadFinished();
+};
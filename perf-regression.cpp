@@ -0,0 +1,242 @@
+
+#include "perf-regression.hpp"
+#include "perf-baseline.hpp"
+#include "perf-filter-chain.hpp"
+#include "perf-util.hpp"
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <util/platform.h>
+#include <util/source-profiler.h>
+#include <algorithm>
+#include <cmath>
+
+/* Costs right after start up or a collection change include loading, they are left out */
+#define REGRESSION_WARMUP 60000
+/* Samples kept per source, one per check, an hour */
+#define REGRESSION_SAMPLES 360
+#define REGRESSION_MIN_SAMPLES 60
+/* Sessions kept per source, and needed before a source is judged */
+#define REGRESSION_SESSIONS 10
+#define REGRESSION_MIN_SESSIONS 3
+#define REGRESSION_CHECK 10000
+/* Modified z-score above which a session counts as an outlier (Iglewicz and Hoaglin) */
+#define REGRESSION_SCORE 3.5
+
+/* Identifies this run of OBS, opening the viewer again continues the same session */
+static qint64 process_session()
+{
+	static const qint64 session = QDateTime::currentMSecsSinceEpoch();
+	return session;
+}
+
+static double median(QList<double> values)
+{
+	auto middle = values.begin() + values.count() / 2;
+	std::nth_element(values.begin(), middle, values.end());
+	return *middle;
+}
+
+static double p95(const QList<float> &samples)
+{
+	QList<float> sorted = samples;
+	auto at = sorted.begin() + (qsizetype)((double)(sorted.count() - 1) * 0.95);
+	std::nth_element(sorted.begin(), at, sorted.end());
+	return *at;
+}
+
+PerfRegressionTracker::PerfRegressionTracker(QObject *parent) : QObject(parent)
+{
+	process_session();
+	obs_frontend_add_event_callback(frontend_event, this);
+	load();
+}
+
+PerfRegressionTracker::~PerfRegressionTracker()
+{
+	obs_frontend_remove_event_callback(frontend_event, this);
+	save();
+}
+
+void PerfRegressionTracker::frontend_event(enum obs_frontend_event event, void *data)
+{
+	auto tracker = static_cast<PerfRegressionTracker *>(data);
+	if (event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGING || event == OBS_FRONTEND_EVENT_EXIT) {
+		tracker->save();
+		tracker->profiles.clear();
+		tracker->collection.clear();
+	} else if (event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED) {
+		tracker->load();
+	}
+}
+
+void PerfRegressionTracker::load()
+{
+	profiles.clear();
+	collection = baseline_collection();
+	started = (qint64)(os_gettime_ns() / 1000000);
+	lastCheck = started;
+	if (collection.isEmpty())
+		return;
+	char *text = os_quick_read_utf8_file(collection_config_path("sessions", collection).toUtf8().constData());
+	if (!text)
+		return;
+	auto file = QJsonDocument::fromJson(QByteArray(text)).object();
+	bfree(text);
+	for (const auto &uuid : file.keys()) {
+		auto object = file.value(uuid).toObject();
+		Profile profile;
+		profile.name = object.value("name").toString();
+		profile.type = object.value("type").toString();
+		for (const auto &value : object.value("sessions").toArray()) {
+			auto session = value.toObject();
+			profile.sessions.append({session.value("session").toInteger(), session.value("p95").toDouble()});
+		}
+		profiles.insert(uuid, profile);
+	}
+}
+
+void PerfRegressionTracker::save()
+{
+	if (collection.isEmpty())
+		return;
+	QJsonObject file;
+	for (auto it = profiles.begin(); it != profiles.end(); ++it) {
+		auto &profile = it.value();
+		// This session replaces its own earlier entry, so reopening the viewer does not count as a new session
+		if (profile.samples.count() >= REGRESSION_MIN_SAMPLES) {
+			double value = p95(profile.samples);
+			if (!profile.sessions.isEmpty() && profile.sessions.last().session == process_session())
+				profile.sessions.last().p95 = value;
+			else
+				profile.sessions.append({process_session(), value});
+			while (profile.sessions.count() > REGRESSION_SESSIONS)
+				profile.sessions.removeFirst();
+		}
+		if (profile.sessions.isEmpty())
+			continue;
+		QJsonArray sessions;
+		for (const auto &session : profile.sessions) {
+			QJsonObject s;
+			s.insert("session", session.session);
+			s.insert("p95", session.p95);
+			sessions.append(s);
+		}
+		QJsonObject object;
+		object.insert("name", profile.name);
+		object.insert("type", profile.type);
+		object.insert("sessions", sessions);
+		file.insert(it.key(), object);
+	}
+	char *dir = obs_module_config_path("sessions");
+	os_mkdirs(dir);
+	bfree(dir);
+	auto json = QJsonDocument(file).toJson(QJsonDocument::Compact);
+	os_quick_write_utf8_file(collection_config_path("sessions", collection).toUtf8().constData(), json.constData(),
+				 (size_t)json.size(), false);
+}
+
+bool PerfRegressionTracker::EnumSource(void *data, obs_source_t *source)
+{
+	auto tracker = static_cast<PerfRegressionTracker *>(data);
+	auto kind = obs_source_get_type(source);
+	if (source_aggregates_items(source) || kind == OBS_SOURCE_TYPE_TRANSITION)
+		return true;
+	if (kind == OBS_SOURCE_TYPE_FILTER) {
+		obs_source_t *parent = obs_filter_get_parent(source);
+		if (!obs_source_enabled(source) || !parent || !obs_source_active(parent))
+			return true;
+	} else if (!obs_source_active(source)) {
+		return true;
+	}
+	profiler_result_t perf;
+	if (!source_profiler_fill_result(source, &perf))
+		return true;
+	if (kind == OBS_SOURCE_TYPE_FILTER)
+		filter_exclusive_result(source, &perf);
+
+	auto &profile = tracker->profiles[QString::fromUtf8(obs_source_get_uuid(source))];
+	profile.name = QString::fromUtf8(obs_source_get_name(source));
+	profile.type = QString::fromUtf8(obs_source_get_display_name(obs_source_get_unversioned_id(source)));
+	auto cost = (float)ns_to_ms(total_cost(&perf));
+	if (profile.samples.count() < REGRESSION_SAMPLES) {
+		profile.samples.append(cost);
+	} else {
+		profile.samples[profile.next] = cost;
+		profile.next = (profile.next + 1) % REGRESSION_SAMPLES;
+	}
+	return true;
+}
+
+void PerfRegressionTracker::sample()
+{
+	if (collection.isEmpty())
+		return;
+	auto now = (qint64)(os_gettime_ns() / 1000000);
+	// Enumerates every source, so it runs once per check instead of once per pass
+	if (now - started < REGRESSION_WARMUP || now - lastCheck < REGRESSION_CHECK)
+		return;
+	lastCheck = now;
+	obs_enum_all_sources(EnumSource, this);
+	check();
+}
+
+void PerfRegressionTracker::check()
+{
+	// Changes below 1% of the frame interval are noise whatever the history says
+	double noise = ns_to_ms(obs_get_frame_interval_ns()) * 0.01;
+	bool found = false;
+	for (auto &profile : profiles) {
+		profile.checked = false;
+		if (profile.samples.count() < REGRESSION_MIN_SAMPLES)
+			continue;
+		QList<double> past;
+		for (const auto &session : profile.sessions) {
+			if (session.session != process_session())
+				past.append(session.p95);
+		}
+		if (past.count() < REGRESSION_MIN_SESSIONS)
+			continue;
+		profile.current = p95(profile.samples);
+		profile.median = median(past);
+		// Median absolute deviation, floored so a history of identical sessions does not make every change significant
+		QList<double> deviations;
+		for (double value : past)
+			deviations.append(std::abs(value - profile.median));
+		double mad = std::max({median(deviations), profile.median * 0.05, noise});
+		profile.score = 0.6745 * (profile.current - profile.median) / mad;
+		profile.checked = true;
+		bool flagged = profile.score > REGRESSION_SCORE && profile.current - profile.median > noise;
+		if (flagged && !profile.flagged) {
+			blog(LOG_WARNING, "[Source Profiler] '%s' is slower than in its last %d sessions: p95 %.02f ms, usually %.02f ms",
+			     profile.name.toUtf8().constData(), (int)past.count(), profile.current, profile.median);
+			found = true;
+		}
+		profile.flagged = flagged;
+	}
+	if (found)
+		emit regressionsFound();
+}
+
+QList<QStringList> PerfRegressionTracker::results() const
+{
+	QList<const Profile *> flagged;
+	for (const auto &profile : profiles) {
+		if (profile.checked && profile.flagged)
+			flagged.append(&profile);
+	}
+	std::sort(flagged.begin(), flagged.end(), [](const Profile *a, const Profile *b) { return a->score > b->score; });
+	QList<QStringList> rows;
+	for (auto profile : flagged) {
+		int sessions = 0;
+		for (const auto &session : profile->sessions) {
+			if (session.session != process_session())
+				sessions++;
+		}
+		rows.append(QStringList{profile->name, profile->type, QString::asprintf("%.02f", profile->current),
+					QString::asprintf("%.02f", profile->median), QString::number(sessions),
+					QString::asprintf("%.01f", profile->score)});
+	}
+	return rows;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "obs-module.h"
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <obs-frontend-api.h>
+
+/* Compares every source's cost this session against its own past sessions, saved per scene collection */
+class PerfRegressionTracker : public QObject {
+	Q_OBJECT
+
+	struct SessionValue {
+		/* Start of the OBS process that measured it, in ms since the epoch */
+		qint64 session;
+		/* p95 of the total cost in ms */
+		double p95;
+	};
+
+	struct Profile {
+		QString name;
+		QString type;
+		QList<SessionValue> sessions;
+		/* Total cost in ms per check after the warm-up, a ring of the latest checks */
+		QList<float> samples;
+		int next = 0;
+		/* Last check, valid when checked */
+		bool checked = false;
+		double current = 0.0;
+		double median = 0.0;
+		double score = 0.0;
+		bool flagged = false;
+	};
+
+	/* By source UUID */
+	QHash<QString, Profile> profiles;
+	QString collection;
+	qint64 started = 0;
+	qint64 lastCheck = 0;
+
+	static bool EnumSource(void *data, obs_source_t *source);
+	static void frontend_event(enum obs_frontend_event event, void *data);
+
+	void load();
+	void save();
+	void check();
+
+public:
+	PerfRegressionTracker(QObject *parent = nullptr);
+	~PerfRegressionTracker() override;
+
+	/* Flagged sources, largest deviation first */
+	QList<QStringList> results() const;
+
+public slots:
+	void sample();
+
+signals:
+	/* Emitted when a check flags a source that was not flagged before */
+	void regressionsFound();
+};
@@ -0,0 +1,51 @@
+
+#include "perf-report.hpp"
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QVBoxLayout>
+
+PerfReportDialog::PerfReportDialog(QWidget *parent, const QString &title, const QStringList &headers,
+				   std::function<QList<QStringList>()> fill_, int interval)
+	: QDialog(parent),
+	  fill(fill_)
+{
+	setWindowTitle(title);
+	setAttribute(Qt::WA_DeleteOnClose);
+	setSizeGripEnabled(true);
+	setGeometry(0, 0, 805, 300);
+
+	list = new QTreeWidget();
+	list->setHeaderLabels(headers);
+	list->setRootIsDecorated(false);
+	list->setAlternatingRowColors(true);
+	list->setUniformRowHeights(true);
+
+	auto l = new QVBoxLayout();
+	l->setContentsMargins(0, 0, 0, 0);
+	l->addWidget(list);
+	setLayout(l);
+
+	refresh();
+	for (int i = 0; i < headers.count(); i++)
+		list->resizeColumnToContents(i);
+
+	if (interval > 0) {
+		timer = new QTimer(this);
+		connect(timer, &QTimer::timeout, this, &PerfReportDialog::refresh);
+		timer->start(interval);
+	}
+
+	show();
+}
+
+void PerfReportDialog::refresh()
+{
+	if (!fill)
+		return;
+	auto rows = fill();
+	list->clear();
+	QList<QTreeWidgetItem *> items;
+	for (const auto &row : rows)
+		items.append(new QTreeWidgetItem(row));
+	list->addTopLevelItems(items);
+}
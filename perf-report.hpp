@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QDialog>
+#include <QStringList>
+#include <QTimer>
+#include <functional>
+
+class QTreeWidget;
+
+/* Non-modal table of rows produced by a report function, refreshed on an interval */
+class PerfReportDialog : public QDialog {
+	Q_OBJECT
+
+	QTreeWidget *list = nullptr;
+	QTimer *timer = nullptr;
+	std::function<QList<QStringList>()> fill;
+
+public:
+	PerfReportDialog(QWidget *parent, const QString &title, const QStringList &headers,
+			 std::function<QList<QStringList>()> fill, int interval = 1000);
+
+public slots:
+	void refresh();
+};
@@ -0,0 +1,169 @@
+
+#include "perf-transition.hpp"
+#include <QDateTime>
+#include <util/platform.h>
+
+/* Transitions kept for the report */
+#define MAX_TRANSITION_RECORDS 100
+
+PerfTransitionTracker::PerfTransitionTracker(QObject *parent) : PerfFrameTracker(parent), records(MAX_TRANSITION_RECORDS)
+{
+	obs_enum_all_sources(EnumConnect, this);
+	signal_handler_connect(obs_get_signal_handler(), "source_create", source_create, this);
+	startSampling();
+}
+
+PerfTransitionTracker::~PerfTransitionTracker()
+{
+	stopSampling();
+	signal_handler_disconnect(obs_get_signal_handler(), "source_create", source_create, this);
+	obs_enum_all_sources(EnumDisconnect, this);
+	obs_weak_source_release(starting.exchange(nullptr));
+	obs_weak_source_release(stopping.exchange(nullptr));
+	obs_source_release(active);
+}
+
+void PerfTransitionTracker::connect_transition(obs_source_t *source, void *data)
+{
+	if (obs_source_get_type(source) != OBS_SOURCE_TYPE_TRANSITION)
+		return;
+	auto sh = obs_source_get_signal_handler(source);
+	signal_handler_connect(sh, "transition_start", transition_start, data);
+	signal_handler_connect(sh, "transition_stop", transition_stop, data);
+}
+
+bool PerfTransitionTracker::EnumConnect(void *data, obs_source_t *source)
+{
+	connect_transition(source, data);
+	return true;
+}
+
+bool PerfTransitionTracker::EnumDisconnect(void *data, obs_source_t *source)
+{
+	if (obs_source_get_type(source) != OBS_SOURCE_TYPE_TRANSITION)
+		return true;
+	auto sh = obs_source_get_signal_handler(source);
+	signal_handler_disconnect(sh, "transition_start", transition_start, data);
+	signal_handler_disconnect(sh, "transition_stop", transition_stop, data);
+	return true;
+}
+
+void PerfTransitionTracker::source_create(void *data, calldata_t *cd)
+{
+	connect_transition(static_cast<obs_source_t *>(calldata_ptr(cd, "source")), data);
+}
+
+void PerfTransitionTracker::hand_over(std::atomic<obs_weak_source_t *> &slot, calldata_t *cd)
+{
+	// A transition removed before the next tick must not be dereferenced there
+	auto source = static_cast<obs_source_t *>(calldata_ptr(cd, "source"));
+	obs_weak_source_release(slot.exchange(obs_source_get_weak_source(source)));
+}
+
+void PerfTransitionTracker::transition_start(void *data, calldata_t *cd)
+{
+	hand_over(static_cast<PerfTransitionTracker *>(data)->starting, cd);
+}
+
+void PerfTransitionTracker::transition_stop(void *data, calldata_t *cd)
+{
+	hand_over(static_cast<PerfTransitionTracker *>(data)->stopping, cd);
+}
+
+void PerfTransitionTracker::sampleFrame()
+{
+	// A cut can start and stop between two ticks, it then still gets one sample
+	obs_weak_source_t *start = starting.exchange(nullptr);
+	obs_weak_source_t *stop = stopping.exchange(nullptr);
+	if (start && !active) {
+		obs_source_t *transition = obs_weak_source_get_source(start);
+		if (transition)
+			begin(transition);
+		obs_source_release(transition);
+	}
+	if (active)
+		sample();
+	if (active && stop && obs_weak_source_references_source(stop, active))
+		end();
+	obs_weak_source_release(start);
+	obs_weak_source_release(stop);
+}
+
+static QString transition_source_name(obs_source_t *transition, enum obs_transition_target target)
+{
+	obs_source_t *source = obs_transition_get_source(transition, target);
+	QString name = QString::fromUtf8(obs_source_get_name(source));
+	obs_source_release(source);
+	return name;
+}
+
+void PerfTransitionTracker::begin(obs_source_t *transition)
+{
+	active = obs_source_get_ref(transition);
+	if (!active)
+		return;
+	current = TransitionRecord();
+	current.transition = QString::fromUtf8(obs_source_get_name(transition));
+	current.from = transition_source_name(transition, OBS_TRANSITION_SOURCE_A);
+	current.to = transition_source_name(transition, OBS_TRANSITION_SOURCE_B);
+	current.start = QDateTime::currentMSecsSinceEpoch();
+	start_ns = os_gettime_ns();
+	start_lagged = obs_get_lagged_frames();
+	start_skipped = video_output_get_skipped_frames(obs_get_video());
+}
+
+static void source_tick(obs_source_t *source, uint64_t &avg, uint64_t &max)
+{
+	profiler_result_t perf;
+	if (!source || !source_profiler_fill_result(source, &perf))
+		return;
+	avg += perf.tick_avg;
+	max += perf.tick_max;
+}
+
+void PerfTransitionTracker::sample()
+{
+	profiler_result_t perf;
+	if (!source_profiler_fill_result(active, &perf))
+		return;
+	// The transition renders both scenes, their ticks are separate
+	obs_source_t *a = obs_transition_get_source(active, OBS_TRANSITION_SOURCE_A);
+	obs_source_t *b = obs_transition_get_source(active, OBS_TRANSITION_SOURCE_B);
+	uint64_t tick_avg = perf.tick_avg;
+	uint64_t tick_max = perf.tick_max;
+	source_tick(a, tick_avg, tick_max);
+	source_tick(b, tick_avg, tick_max);
+	obs_source_release(a);
+	obs_source_release(b);
+	current.cost.add(tick_avg, tick_max, perf);
+}
+
+void PerfTransitionTracker::end()
+{
+	current.duration = os_gettime_ns() - start_ns;
+	uint32_t lagged = obs_get_lagged_frames();
+	uint32_t skipped = video_output_get_skipped_frames(obs_get_video());
+	current.over_budget = (lagged >= start_lagged ? lagged - start_lagged : 0) +
+			      (skipped >= start_skipped ? skipped - start_skipped : 0);
+	obs_source_release(active);
+	active = nullptr;
+
+	TransitionRecord record = current;
+	post([this, record] { records.append(record); });
+}
+
+QList<QStringList> PerfTransitionTracker::results() const
+{
+	QList<QStringList> rows;
+	const auto &list = records.list();
+	for (auto i = list.count() - 1; i >= 0; i--) {
+		const auto &record = list.at(i);
+		rows.append(QStringList{QDateTime::fromMSecsSinceEpoch(record.start).toString("HH:mm:ss.zzz"), record.transition,
+					record.from, record.to, QString::asprintf("%.0f", (double)record.duration / 1000000.0),
+					QString::number(record.cost.frames),
+					QString::asprintf("%.02f", (double)record.cost.mean() / 1000000.0),
+					QString::asprintf("%.02f", (double)record.cost.peak / 1000000.0),
+					QString::number(record.over_budget)});
+	}
+	return rows;
+}
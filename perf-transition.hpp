@@ -0,0 +1,59 @@
+#pragma once
+
+#include "obs-module.h"
+#include "perf-frame.hpp"
+#include <QStringList>
+#include <atomic>
+
+/* Cost of one transition, sampled every frame while it ran */
+struct TransitionRecord {
+	QString transition;
+	QString from;
+	QString to;
+	qint64 start = 0;
+	uint64_t duration = 0;
+	/* Transition render plus the tick of the transition and both scenes */
+	PerfFrameCost cost;
+	/* Lagged and skipped frames of the whole output while the transition ran, the profiler keeps no per-frame cost to
+	 * compare against the frame interval */
+	uint32_t over_budget = 0;
+};
+
+/* Switches to per-frame sampling while any transition runs */
+class PerfTransitionTracker : public PerfFrameTracker {
+	Q_OBJECT
+
+	PerfRecordRing<TransitionRecord> records;
+
+	/* Set by the transition signals and taken by the tick callback, each holds a weak reference */
+	std::atomic<obs_weak_source_t *> starting{nullptr};
+	std::atomic<obs_weak_source_t *> stopping{nullptr};
+
+	/* Capture state, only touched on the graphics thread */
+	obs_source_t *active = nullptr;
+	TransitionRecord current;
+	uint64_t start_ns = 0;
+	uint32_t start_lagged = 0;
+	uint32_t start_skipped = 0;
+
+	void begin(obs_source_t *transition);
+	void sample();
+	void end();
+
+	static void connect_transition(obs_source_t *source, void *data);
+	static bool EnumConnect(void *data, obs_source_t *source);
+	static bool EnumDisconnect(void *data, obs_source_t *source);
+	static void source_create(void *data, calldata_t *cd);
+	static void hand_over(std::atomic<obs_weak_source_t *> &slot, calldata_t *cd);
+	static void transition_start(void *data, calldata_t *cd);
+	static void transition_stop(void *data, calldata_t *cd);
+
+protected:
+	void sampleFrame() override;
+
+public:
+	PerfTransitionTracker(QObject *parent = nullptr);
+	~PerfTransitionTracker() override;
+
+	QList<QStringList> results() const;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "obs-module.h"
+#include <util/source-profiler.h>
+
+/* Profiler durations are ns, everything shown is ms */
+static inline double ns_to_ms(uint64_t ns)
+{
+	return (double)ns / 1000000.0;
+}
+
+/* Tick plus CPU and GPU render time of all renders in a frame */
+static inline uint64_t total_cost(const profiler_result_t *perf)
+{
+	return perf->tick_avg + perf->render_sum + perf->render_gpu_sum;
+}
+
+/* Scenes only aggregate their items, whose costs are already counted on their own */
+static inline bool source_aggregates_items(obs_source_t *source)
+{
+	return obs_source_get_type(source) == OBS_SOURCE_TYPE_SCENE;
+}
@@ -2,6 +2,20 @@
 #include "version.h"
 
 #include "source-profiler.hpp"
+#include "perf-report.hpp"
+#include "perf-filter-chain.hpp"
+#include "perf-experiment.hpp"
+#include "perf-budget.hpp"
+#include "perf-lag.hpp"
+#include "perf-advisor.hpp"
+#include "perf-regression.hpp"
+#include "perf-transition.hpp"
+#include "perf-activation.hpp"
+#include "perf-load.hpp"
+#include "perf-history.hpp"
+#include "perf-heatmap.hpp"
+#include "perf-icicle.hpp"
+#include "perf-util.hpp"
 #include <obs-frontend-api.h>
 #include <QAction>
 #include <QMainWindow>
@@ -14,9 +28,17 @@
 #include <QHeaderView>
 #include <QComboBox>
 #include <QMenu>
+#include <QInputDialog>
+#include <QMessageBox>
 #include <QStyledItemDelegate>
 #include <QPainter>
+#include <QTimer>
+#include <QDateTime>
+#include <QHash>
 #include <util/config-file.h>
+#include <util/platform.h>
+#include <algorithm>
+#include <cmath>
 
 OBS_DECLARE_MODULE()
 OBS_MODULE_AUTHOR("Exeldro");
@@ -79,7 +101,14 @@ OBSPerfViewer::OBSPerfViewer(QWidget *parent) : QDialog(parent)
 	model = new PerfTreeModel(this);
 
 	proxy = new PerfViewerProxyModel(this);
+	experiments = new PerfExperimentRunner(this);
 	proxy->setSourceModel(model);
+	lagTracker = new PerfLagTracker(model, this);
+	advisor = new PerfAdvisor(model, this);
+	regressionTracker = new PerfRegressionTracker(this);
+	transitionTracker = new PerfTransitionTracker(this);
+	activationTracker = new PerfActivationTracker(this);
+	loadProfiler = new PerfLoadProfiler(this);
 
 	treeView = new QTreeView();
 	treeView->setModel(proxy);
@@ -88,6 +117,49 @@ OBSPerfViewer::OBSPerfViewer(QWidget *parent) : QDialog(parent)
 	treeView->setAlternatingRowColors(true);
 	treeView->setAnimated(true);
 	treeView->setSelectionMode(QAbstractItemView::SingleSelection);
+	treeView->setContextMenuPolicy(Qt::CustomContextMenu);
+	connect(treeView, &QTreeView::customContextMenuRequested, this, [&](const QPoint &pos) {
+		auto index = proxy->mapToSource(treeView->indexAt(pos));
+		if (!index.isValid())
+			return;
+		auto item = static_cast<PerfTreeItem *>(index.internalPointer());
+		obs_source_t *source = obs_weak_source_get_source(item->weakSource());
+		if (!source)
+			return;
+		// Filter rows open the chain of the source they are applied to
+		obs_source_t *target = source;
+		if (obs_source_get_type(source) == OBS_SOURCE_TYPE_FILTER)
+			target = obs_filter_get_parent(source);
+		QMenu menu;
+		auto chainAction = menu.addAction(QString::fromUtf8(obs_module_text("PerfViewer.FilterChain")));
+		chainAction->setEnabled(target && obs_source_filter_count(target) > 0);
+		auto experimentAction = menu.addAction(QString::fromUtf8(obs_module_text("PerfViewer.Experiment")));
+		experimentAction->setEnabled(target != source || item->sceneItem());
+		auto historyAction = menu.addAction(QString::fromUtf8(obs_module_text("PerfViewer.History")));
+		auto pinAction = menu.addAction(QString::fromUtf8(obs_module_text("PerfViewer.Pin")));
+		pinAction->setCheckable(true);
+		pinAction->setChecked(item->isPinned());
+		auto chosen = menu.exec(QCursor::pos());
+		if (chosen == chainAction && target) {
+			new PerfFilterChainDialog(this, target);
+		} else if (chosen == historyAction) {
+			new PerfHistoryDialog(this, model, source);
+		} else if (chosen == pinAction) {
+			model->setPinned(item, pinAction->isChecked());
+		} else if (chosen == experimentAction) {
+			if (target != source)
+				experiments->addFilter(source);
+			else
+				experiments->addSceneItem(item->sceneItem());
+			showExperiments();
+		}
+		obs_source_release(source);
+	});
+
+	connect(treeView, &QTreeView::expanded, this,
+		[&](const QModelIndex &index) { model->setExpanded(proxy->mapToSource(index), true); });
+	connect(treeView, &QTreeView::collapsed, this,
+		[&](const QModelIndex &index) { model->setExpanded(proxy->mapToSource(index), false); });
 
 	for (int i = 0; i < model->columnCount(); i++) {
 		if (model->columnType(i) == COLUMN_TYPE_GRAPH) {
@@ -124,6 +196,12 @@ OBSPerfViewer::OBSPerfViewer(QWidget *parent) : QDialog(parent)
 					treeView->resizeColumnToContents(i);
 			});
 		}
+		menu.addSeparator();
+		auto customAction = menu.addAction(QString::fromUtf8(obs_module_text("PerfViewer.CustomColumns")));
+		connect(customAction, &QAction::triggered, this, [this] {
+			new PerfExpressionDialog(this, expressions,
+						 [this](const QList<ExpressionColumn> &columns) { setExpressions(columns); });
+		});
 		menu.exec(QCursor::pos());
 	});
 
@@ -138,20 +216,55 @@ OBSPerfViewer::OBSPerfViewer(QWidget *parent) : QDialog(parent)
 	groupByBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.Filter")));
 	groupByBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.Transition")));
 	groupByBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.All")));
+	groupByBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.Hotspots")));
+	groupByBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.SourceTypes")));
 	searchBarLayout->addWidget(groupByBox);
+
+	auto hotspotMetricBox = new QComboBox();
+	hotspotMetricBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.TotalPercentage")), PerfTreeModel::HOTSPOT_TOTAL);
+	hotspotMetricBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.CpuPercentage")), PerfTreeModel::HOTSPOT_CPU);
+#ifndef __APPLE__
+	hotspotMetricBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.GpuPercentage")), PerfTreeModel::HOTSPOT_GPU);
+#endif
+	hotspotMetricBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.TickMax")), PerfTreeModel::HOTSPOT_TICK_MAX);
+	hotspotMetricBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.RenderMax")), PerfTreeModel::HOTSPOT_RENDER_MAX);
+	searchBarLayout->addWidget(hotspotMetricBox);
+
+	auto hotspotCount = new QSpinBox();
+	hotspotCount->setPrefix(QString::fromUtf8(obs_module_text("PerfViewer.HotspotTop")));
+	hotspotCount->setMinimum(1);
+	hotspotCount->setMaximum(500);
+	searchBarLayout->addWidget(hotspotCount);
 	searchBarLayout->addSpacerItem(new QSpacerItem(20, 20, QSizePolicy::Expanding));
 
+	auto sharedBox = new QComboBox();
+	sharedBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.SharedFull")));
+	sharedBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.SharedEven")));
+	sharedBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.SharedRenderWeighted")));
+	sharedBox->setToolTip(QString::fromUtf8(obs_module_text("PerfViewer.SharedAttribution")));
+	searchBarLayout->addWidget(sharedBox);
+
 	auto onlyActiveCheckBox = new QCheckBox(QString::fromUtf8(obs_module_text("PerfViewer.OnlyActive")));
 	searchBarLayout->addWidget(onlyActiveCheckBox);
+
+	auto pipelineCheckBox = new QCheckBox(QString::fromUtf8(obs_module_text("PerfViewer.Pipeline")));
+	searchBarLayout->addWidget(pipelineCheckBox);
+
+	auto budgetCheckBox = new QCheckBox(QString::fromUtf8(obs_module_text("PerfViewer.FrameBudget")));
+	searchBarLayout->addWidget(budgetCheckBox);
 	searchBarLayout->addSpacerItem(new QSpacerItem(20, 20, QSizePolicy::Expanding));
 
 	auto searchBox = new QLineEdit();
 	searchBox->setMinimumSize(256, 0);
 	searchBox->setPlaceholderText(QString::fromUtf8(obs_module_text("PerfViewer.Search")));
+	searchBox->setToolTip(QString::fromUtf8(obs_module_text("PerfViewer.SearchHelp")));
 	searchBarLayout->addWidget(searchBox);
 
 	l->addLayout(searchBarLayout);
 
+	budget = new PerfBudgetWidget(model);
+	l->addWidget(budget);
+
 	l->addWidget(treeView);
 
 	auto buttonLayout = new QHBoxLayout();
@@ -175,6 +288,124 @@ OBSPerfViewer::OBSPerfViewer(QWidget *parent) : QDialog(parent)
 	refreshLabel->setBuddy(refreshInterval);
 	buttonLayout->addWidget(refreshInterval);
 
+	auto rankingLabel = new QLabel(QString::fromUtf8(obs_module_text("PerfViewer.Ranking")));
+	buttonLayout->addWidget(rankingLabel);
+
+	rankingBox = new QComboBox();
+	rankingBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.RankingLive")), 0);
+	rankingBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.RankingStable")), -1);
+	for (int seconds : {5, 10, 30})
+		rankingBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.RankingEvery")).arg(seconds), seconds * 1000);
+	rankingLabel->setBuddy(rankingBox);
+	buttonLayout->addWidget(rankingBox);
+
+	auto graphSpanLabel = new QLabel(QString::fromUtf8(obs_module_text("PerfViewer.GraphSpan")));
+	buttonLayout->addWidget(graphSpanLabel);
+
+	graphSpanBox = new QComboBox();
+	graphSpanBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.GraphLive")), 0);
+	graphSpanBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.GraphMinutes")).arg(10), 600000);
+	for (int hours : {1, 6, 24})
+		graphSpanBox->addItem(QString::fromUtf8(obs_module_text("PerfViewer.GraphHours")).arg(hours), hours * 3600000);
+	graphSpanLabel->setBuddy(graphSpanBox);
+	buttonLayout->addWidget(graphSpanBox);
+
+	auto reportsButton = new QPushButton(QString::fromUtf8(obs_module_text("PerfViewer.Reports")));
+	auto reportsMenu = new QMenu(reportsButton);
+	auto redundantAction = reportsMenu->addAction(QString::fromUtf8(obs_module_text("PerfViewer.RedundantRenders")));
+	connect(redundantAction, &QAction::triggered, this, [this] {
+		new PerfReportDialog(this, QString::fromUtf8(obs_module_text("PerfViewer.RedundantRenders")),
+				     {QString::fromUtf8(obs_module_text("PerfViewer.Name")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.SourceDisplayName")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.RendersPerFrame")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.RedundantCpu")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.RedundantGpu")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.ReferencedBy"))},
+				     PerfTreeModel::redundantRenders);
+	});
+	auto advisorAction = reportsMenu->addAction(QString::fromUtf8(obs_module_text("PerfViewer.Advisor")));
+	connect(advisorAction, &QAction::triggered, this, [this] {
+		auto rules = advisor;
+		new PerfReportDialog(this, QString::fromUtf8(obs_module_text("PerfViewer.Advisor")),
+				     {QString::fromUtf8(obs_module_text("PerfViewer.AdvisorFinding")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.Name")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.SourceDisplayName")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.AdvisorDetail")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.AdvisorSavings"))},
+				     [rules] { return rules->results(); });
+	});
+	auto regressionsAction = reportsMenu->addAction(QString::fromUtf8(obs_module_text("PerfViewer.Regressions")));
+	connect(regressionsAction, &QAction::triggered, this, &OBSPerfViewer::showRegressions);
+	connect(regressionTracker, &PerfRegressionTracker::regressionsFound, this, &OBSPerfViewer::showRegressions);
+	auto culpritsAction = reportsMenu->addAction(QString::fromUtf8(obs_module_text("PerfViewer.LikelyCulprits")));
+	connect(culpritsAction, &QAction::triggered, this, [this] {
+		auto tracker = lagTracker;
+		new PerfReportDialog(this, QString::fromUtf8(obs_module_text("PerfViewer.LikelyCulprits")),
+				     {QString::fromUtf8(obs_module_text("PerfViewer.Name")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.SourceDisplayName")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.CulpritScore")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.CulpritLagSpike")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.CulpritCalmSpike")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.CulpritEvents"))},
+				     [tracker] { return tracker->culprits(); });
+	});
+	auto transitionsAction = reportsMenu->addAction(QString::fromUtf8(obs_module_text("PerfViewer.Transitions")));
+	connect(transitionsAction, &QAction::triggered, this, [this] {
+		auto tracker = transitionTracker;
+		new PerfReportDialog(this, QString::fromUtf8(obs_module_text("PerfViewer.Transitions")),
+				     {QString::fromUtf8(obs_module_text("PerfViewer.EventTime")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.Transition")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.TransitionFrom")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.TransitionTo")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.TransitionDuration")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.TransitionFrames")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.TransitionMean")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.TransitionPeak")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.TransitionOverBudget"))},
+				     [tracker] { return tracker->results(); });
+	});
+	auto activationsAction = reportsMenu->addAction(QString::fromUtf8(obs_module_text("PerfViewer.Activations")));
+	connect(activationsAction, &QAction::triggered, this, [this] {
+		auto tracker = activationTracker;
+		new PerfReportDialog(this, QString::fromUtf8(obs_module_text("PerfViewer.Activations")),
+				     {QString::fromUtf8(obs_module_text("PerfViewer.EventTime")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.Name")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.SourceDisplayName")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.FirstFrameLatency")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.AverageLatency")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.WarmupFrames")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.WarmupMean")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.WarmupPeak"))},
+				     [tracker] { return tracker->results(); });
+	});
+	auto loadAction = reportsMenu->addAction(QString::fromUtf8(obs_module_text("PerfViewer.CollectionLoad")));
+	connect(loadAction, &QAction::triggered, this, &OBSPerfViewer::showCollectionLoad);
+	connect(loadProfiler, &PerfLoadProfiler::loadFinished, this, &OBSPerfViewer::showCollectionLoad);
+	auto heatmapAction = reportsMenu->addAction(QString::fromUtf8(obs_module_text("PerfViewer.Heatmap")));
+	connect(heatmapAction, &QAction::triggered, this, [this] { new PerfHeatmapDialog(this, model); });
+	auto icicleAction = reportsMenu->addAction(QString::fromUtf8(obs_module_text("PerfViewer.Icicle")));
+	connect(icicleAction, &QAction::triggered, this, [this] { new PerfIcicleDialog(this, model); });
+	auto eventsAction = reportsMenu->addAction(QString::fromUtf8(obs_module_text("PerfViewer.Events")));
+	connect(eventsAction, &QAction::triggered, this, [this] {
+		auto markerModel = model;
+		new PerfReportDialog(this, QString::fromUtf8(obs_module_text("PerfViewer.Events")),
+				     {QString::fromUtf8(obs_module_text("PerfViewer.EventTime")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.Event")),
+				      QString::fromUtf8(obs_module_text("PerfViewer.EventDetail"))},
+				     [markerModel] { return markerModel->markerRows(); });
+	});
+	auto experimentsAction = reportsMenu->addAction(QString::fromUtf8(obs_module_text("PerfViewer.Experiments")));
+	connect(experimentsAction, &QAction::triggered, this, &OBSPerfViewer::showExperiments);
+	reportsButton->setMenu(reportsMenu);
+	buttonLayout->addWidget(reportsButton);
+
+	auto baselineButton = new QPushButton(QString::fromUtf8(obs_module_text("PerfViewer.Baseline")));
+	baselineMenu = new QMenu(baselineButton);
+	// Saved baselines are listed fresh, they are per collection
+	connect(baselineMenu, &QMenu::aboutToShow, this, &OBSPerfViewer::updateBaselineMenu);
+	baselineButton->setMenu(baselineMenu);
+	buttonLayout->addWidget(baselineButton);
+
 	auto resetButton = new QPushButton(QString::fromUtf8(obs_frontend_get_locale_string("Reset")));
 	buttonLayout->addWidget(resetButton);
 
@@ -187,11 +418,19 @@ OBSPerfViewer::OBSPerfViewer(QWidget *parent) : QDialog(parent)
 	connect(closeButton, &QPushButton::clicked, this, &OBSPerfViewer::close);
 	connect(resetButton, &QAbstractButton::clicked, model, &PerfTreeModel::refreshSources);
 	connect(model, &PerfTreeModel::modelReset, this, &OBSPerfViewer::sourceListUpdated);
-	connect(groupByBox, &QComboBox::currentIndexChanged, this, [&](int index) {
+	connect(groupByBox, &QComboBox::currentIndexChanged, this, [&, hotspotMetricBox, hotspotCount](int index) {
+		hotspotMetricBox->setVisible(index == PerfTreeModel::HOTSPOTS);
+		hotspotCount->setVisible(index == PerfTreeModel::HOTSPOTS);
 		if (index < 0 || model->getShowMode() == index)
 			return;
 		model->setShowMode((PerfTreeModel::ShowMode)index);
 	});
+	connect(hotspotMetricBox, &QComboBox::currentIndexChanged, this, [&, hotspotMetricBox]() {
+		model->setHotspotMetric((PerfTreeModel::HotspotMetric)hotspotMetricBox->currentData().toInt());
+	});
+	connect(sharedBox, &QComboBox::currentIndexChanged, this,
+		[&](int index) { model->setSharedAttribution((PerfTreeModel::SharedAttribution)index); });
+	connect(hotspotCount, &QSpinBox::valueChanged, this, [&](int count) { model->setHotspotCount(count); });
 #if QT_VERSION >= QT_VERSION_CHECK(6, 7, 0)
 	connect(onlyActiveCheckBox, &QCheckBox::checkStateChanged, this, [&, onlyActiveCheckBox]() {
 #else
@@ -202,12 +441,39 @@ OBSPerfViewer::OBSPerfViewer(QWidget *parent) : QDialog(parent)
 			return;
 		model->setActiveOnly(checked);
 	});
-	connect(searchBox, &QLineEdit::textChanged, this, [&](const QString &text) {
+	// Debounce typing so the filter is applied once per pause instead of once per keystroke
+	auto searchTimer = new QTimer(this);
+	searchTimer->setSingleShot(true);
+	searchTimer->setInterval(200);
+	connect(searchTimer, &QTimer::timeout, this, [&, searchBox]() {
+		auto text = searchBox->text();
 		proxy->setFilterText(text);
-		if (!text.isEmpty())
+		if (!text.isEmpty()) {
 			treeView->expandAll();
+			syncExpanded();
+		}
 	});
+	connect(searchBox, &QLineEdit::textChanged, searchTimer, [searchTimer]() { searchTimer->start(); });
 	connect(refreshInterval, &QSpinBox::valueChanged, model, &PerfTreeModel::setRefreshInterval);
+	connect(rankingBox, &QComboBox::currentIndexChanged, this, [&]() {
+		int ranking = rankingBox->currentData().toInt();
+		// Stable ranking keeps rows in place until they differ by more than 10%
+		proxy->setRankHysteresis(ranking < 0 ? 0.1 : 0.0);
+		proxy->setRankInterval(ranking > 0 ? ranking : 0);
+	});
+	connect(graphSpanBox, &QComboBox::currentIndexChanged, this,
+		[&]() { model->setGraphSpan(graphSpanBox->currentData().toLongLong()); });
+	connect(model, &PerfTreeModel::updated, proxy, &PerfViewerProxyModel::dataUpdated);
+	connect(model, &QAbstractItemModel::rowsInserted, proxy, &PerfViewerProxyModel::rowsAdded);
+	connect(model, &PerfTreeModel::updated, budget, &PerfBudgetWidget::sample);
+	connect(model, &PerfTreeModel::updated, lagTracker, &PerfLagTracker::sample);
+	connect(model, &PerfTreeModel::updated, advisor, &PerfAdvisor::sample);
+	connect(model, &PerfTreeModel::updated, regressionTracker, &PerfRegressionTracker::sample);
+	connect(budgetCheckBox, &QCheckBox::toggled, budget, &QWidget::setVisible);
+	connect(pipelineCheckBox, &QCheckBox::toggled, this, [&](bool checked) {
+		if (checked != model->getShowPipeline())
+			model->setShowPipeline(checked);
+	});
 
 	source_profiler_enable(true);
 #ifndef __APPLE__
@@ -219,6 +485,14 @@ OBSPerfViewer::OBSPerfViewer(QWidget *parent) : QDialog(parent)
 	config_set_default_bool(obs_config, "PerfViewer", "active", true);
 	bool active_only = config_get_bool(obs_config, "PerfViewer", "active");
 	model->setActiveOnly(active_only, false);
+	model->setShowPipeline(config_get_bool(obs_config, "PerfViewer", "pipeline"), false);
+	model->setPinnedSources(QString::fromUtf8(config_get_string(obs_config, "PerfViewer", "pinned"))
+					.split(QChar(';'), Qt::SkipEmptyParts));
+	config_set_default_int(obs_config, "PerfViewer", "hotspotcount", 20);
+	config_set_default_int(obs_config, "PerfViewer", "shared", PerfTreeModel::SHARED_FULL);
+	model->setSharedAttribution((enum PerfTreeModel::SharedAttribution)config_get_int(obs_config, "PerfViewer", "shared"));
+	model->setHotspotMetric((enum PerfTreeModel::HotspotMetric)config_get_int(obs_config, "PerfViewer", "hotspotmetric"));
+	model->setHotspotCount((int)config_get_int(obs_config, "PerfViewer", "hotspotcount"));
 	model->setShowMode((enum PerfTreeModel::ShowMode)show_mode);
 
 	const char *geom = config_get_string(obs_config, "PerfViewer", "geometry");
@@ -228,7 +502,25 @@ OBSPerfViewer::OBSPerfViewer(QWidget *parent) : QDialog(parent)
 	}
 
 	groupByBox->setCurrentIndex(show_mode);
+	sharedBox->setCurrentIndex(model->getSharedAttribution());
+	// A GPU metric saved on another platform falls back to the first entry
+	hotspotMetricBox->setCurrentIndex(std::max(hotspotMetricBox->findData(model->getHotspotMetric()), 0));
+	model->setHotspotMetric((PerfTreeModel::HotspotMetric)hotspotMetricBox->currentData().toInt());
+	hotspotCount->setValue(model->getHotspotCount());
+	hotspotMetricBox->setVisible(show_mode == PerfTreeModel::HOTSPOTS);
+	hotspotCount->setVisible(show_mode == PerfTreeModel::HOTSPOTS);
 	onlyActiveCheckBox->setChecked(active_only);
+	pipelineCheckBox->setChecked(model->getShowPipeline());
+	config_set_default_bool(obs_config, "PerfViewer", "budget", true);
+	budgetCheckBox->setChecked(config_get_bool(obs_config, "PerfViewer", "budget"));
+	budget->setVisible(budgetCheckBox->isChecked());
+	rankingBox->setCurrentIndex((int)config_get_int(obs_config, "PerfViewer", "ranking"));
+	graphSpanBox->setCurrentIndex((int)config_get_int(obs_config, "PerfViewer", "graphspan"));
+
+	// Before the header state, which includes the sections of these columns
+	expressions = expression_columns_load(config_get_string(obs_config, "PerfViewer", "expressions"));
+	model->setExpressionColumns(expressions);
+	advisor->setAlerts(expressions);
 
 	const char *columns = config_get_string(obs_config, "PerfViewer", "columns");
 	if (columns != nullptr) {
@@ -242,12 +534,24 @@ OBSPerfViewer::OBSPerfViewer(QWidget *parent) : QDialog(parent)
 OBSPerfViewer::~OBSPerfViewer()
 {
 	perf_viewer = nullptr;
+	// Restore whatever an unfinished experiment turned off
+	experiments->stop();
 	const auto obs_config = obs_frontend_get_user_config();
 	if (obs_config) {
 		config_set_string(obs_config, "PerfViewer", "columns", treeView->header()->saveState().toBase64().constData());
 		config_set_string(obs_config, "PerfViewer", "geometry", saveGeometry().toBase64().constData());
 		config_set_int(obs_config, "PerfViewer", "showmode", model->getShowMode());
+		config_set_int(obs_config, "PerfViewer", "shared", model->getSharedAttribution());
+		config_set_int(obs_config, "PerfViewer", "hotspotmetric", model->getHotspotMetric());
+		config_set_int(obs_config, "PerfViewer", "hotspotcount", model->getHotspotCount());
 		config_set_bool(obs_config, "PerfViewer", "active", model->getActiveOnly());
+		config_set_int(obs_config, "PerfViewer", "ranking", rankingBox->currentIndex());
+		config_set_int(obs_config, "PerfViewer", "graphspan", graphSpanBox->currentIndex());
+		config_set_bool(obs_config, "PerfViewer", "budget", !budget->isHidden());
+		config_set_bool(obs_config, "PerfViewer", "pipeline", model->getShowPipeline());
+		config_set_string(obs_config, "PerfViewer", "expressions", expression_columns_save(expressions).constData());
+		config_set_string(obs_config, "PerfViewer", "pinned",
+				  model->getPinnedSources().join(QChar(';')).toUtf8().constData());
 		config_save(obs_config);
 	}
 #ifndef __APPLE__
@@ -257,222 +561,454 @@ OBSPerfViewer::~OBSPerfViewer()
 	delete model;
 }
 
-PerfTreeColumn::PerfTreeColumn(QString name, QVariant (*getValue)(const PerfTreeItem *item), enum PerfTreeColumnType column_type,
-			       bool default_hidden)
-	: m_get_value(getValue),
-	  m_name(name),
-	  m_column_type(column_type),
-	  m_default_hidden(default_hidden)
+PerfTreeColumn::PerfTreeColumn(const char *name, const QString &(*getText)(const PerfTreeItem *item),
+			       enum PerfTreeColumnType column_type, bool default_hidden)
+	: m_name(name),
+	  m_value_type(VALUE_TYPE_TEXT),
+	  m_has_value(nullptr),
+	  m_default_hidden(default_hidden),
+	  m_column_type(column_type)
+{
+	m_get.text = getText;
+}
+
+PerfTreeColumn::PerfTreeColumn(const char *name, bool (*getBool)(const PerfTreeItem *item), enum PerfTreeColumnType column_type,
+			       bool default_hidden, bool (*hasValue)(const PerfTreeItem *item))
+	: m_name(name),
+	  m_value_type(VALUE_TYPE_BOOL),
+	  m_has_value(hasValue),
+	  m_default_hidden(default_hidden),
+	  m_column_type(column_type)
+{
+	m_get.boolean = getBool;
+}
+
+PerfTreeColumn::PerfTreeColumn(const char *name, double (*getDouble)(const PerfTreeItem *item), enum PerfTreeColumnType column_type,
+			       bool default_hidden, bool (*hasValue)(const PerfTreeItem *item))
+	: m_name(name),
+	  m_value_type(VALUE_TYPE_DOUBLE),
+	  m_has_value(hasValue),
+	  m_default_hidden(default_hidden),
+	  m_column_type(column_type)
+{
+	m_get.number = getDouble;
+}
+
+PerfTreeColumn::PerfTreeColumn(const char *name, uint64_t (*getUint)(const PerfTreeItem *item), enum PerfTreeColumnType column_type,
+			       bool default_hidden, bool (*hasValue)(const PerfTreeItem *item))
+	: m_name(name),
+	  m_value_type(column_type == COLUMN_TYPE_DURATION || column_type == COLUMN_TYPE_INTERVAL ? VALUE_TYPE_NS
+												    : VALUE_TYPE_UINT),
+	  m_has_value(hasValue),
+	  m_default_hidden(default_hidden),
+	  m_column_type(column_type)
+{
+	m_get.uint = getUint;
+}
+
+PerfTreeColumn::PerfTreeColumn(const char *name, enum PerfTreeColumnType column_type)
+	: m_name(name),
+	  m_value_type(VALUE_TYPE_NONE),
+	  m_has_value(nullptr),
+	  m_default_hidden(false),
+	  m_column_type(column_type)
+{
+	m_get.number = nullptr;
+}
+
+static enum PerfTreeColumnType expression_column_type(enum ExpressionFormat format)
+{
+	switch (format) {
+	case EXPRESSION_FORMAT_DURATION:
+		return COLUMN_TYPE_DURATION;
+	case EXPRESSION_FORMAT_PERCENTAGE:
+		return COLUMN_TYPE_PERCENTAGE;
+	case EXPRESSION_FORMAT_SCORE:
+		return COLUMN_TYPE_SCORE;
+	default:
+		// Right aligned without a color
+		return COLUMN_TYPE_RATIO;
+	}
+}
+
+PerfTreeColumn::PerfTreeColumn(const ExpressionColumn &column, int index)
+	: m_name(nullptr),
+	  m_value_type(VALUE_TYPE_EXPRESSION),
+	  m_has_value(nullptr),
+	  m_default_hidden(false),
+	  m_expression(column.expression),
+	  m_expression_index(index),
+	  m_title(column.name),
+	  m_column_type(expression_column_type(column.format))
+{
+	m_get.number = nullptr;
+}
+
+bool PerfTreeColumn::HasValue(const PerfTreeItem *item) const
+{
+	if (m_value_type == VALUE_TYPE_NONE)
+		return false;
+	return !m_has_value || m_has_value(item);
+}
+
+double PerfTreeColumn::Number(const PerfTreeItem *item) const
+{
+	switch (m_value_type) {
+	case VALUE_TYPE_BOOL:
+		return m_get.boolean(item) ? 1.0 : 0.0;
+	case VALUE_TYPE_DOUBLE:
+		return m_get.number(item);
+	case VALUE_TYPE_NS:
+		return ns_to_ms(m_get.uint(item));
+	case VALUE_TYPE_UINT:
+		return (double)m_get.uint(item);
+	case VALUE_TYPE_EXPRESSION: {
+		// Evaluated once per pass by the updater, here only until the pass after the columns changed
+		auto cached = item->expressionValues();
+		if (cached && m_expression_index < cached->values.count() &&
+		    cached->expressions->at(m_expression_index) == m_expression)
+			return cached->values.at(m_expression_index);
+		ExpressionInput input;
+		item->expressionInput(input);
+		return m_expression->evaluate(input);
+	}
+	default:
+		return 0.0;
+	}
+}
+
+QString PerfTreeColumn::Text(const PerfTreeItem *item) const
+{
+	if (!HasValue(item))
+		return {};
+	switch (m_value_type) {
+	case VALUE_TYPE_TEXT:
+		return m_get.text(item);
+	case VALUE_TYPE_DOUBLE:
+	case VALUE_TYPE_NS: {
+		double d = Number(item);
+		if (d < 0.005)
+			return {};
+		return QString::asprintf("%.02f", d);
+	}
+	case VALUE_TYPE_UINT:
+		return QString::number(m_get.uint(item));
+	case VALUE_TYPE_EXPRESSION: {
+		// Expressions can go negative, like the headroom left in a budget
+		double d = Number(item);
+		if (std::abs(d) < 0.005)
+			return {};
+		return QString::asprintf("%.02f", d);
+	}
+	default:
+		return {};
+	}
+}
+
+QVariant PerfTreeColumn::Value(const PerfTreeItem *item) const
+{
+	if (!HasValue(item))
+		return {};
+	switch (m_value_type) {
+	case VALUE_TYPE_TEXT:
+		return m_get.text(item);
+	case VALUE_TYPE_BOOL:
+		return m_get.boolean(item);
+	case VALUE_TYPE_UINT:
+		return (qulonglong)m_get.uint(item);
+	default:
+		return Number(item);
+	}
+}
+
+int PerfTreeColumn::Compare(const PerfTreeItem *left, const PerfTreeItem *right) const
+{
+	bool lv = HasValue(left);
+	bool rv = HasValue(right);
+	if (!lv || !rv)
+		return (int)lv - (int)rv;
+	switch (m_value_type) {
+	case VALUE_TYPE_TEXT:
+		return m_get.text(left).localeAwareCompare(m_get.text(right));
+	case VALUE_TYPE_BOOL:
+		return (int)m_get.boolean(left) - (int)m_get.boolean(right);
+	case VALUE_TYPE_DOUBLE:
+	case VALUE_TYPE_EXPRESSION: {
+		double l = Number(left);
+		double r = Number(right);
+		return l < r ? -1 : (r < l ? 1 : 0);
+	}
+	case VALUE_TYPE_NS:
+	case VALUE_TYPE_UINT: {
+		uint64_t l = m_get.uint(left);
+		uint64_t r = m_get.uint(right);
+		return l < r ? -1 : (r < l ? 1 : 0);
+	}
+	default:
+		return 0;
+	}
+}
+
+static double frame_percentage(uint64_t ns)
+{
+	return (double)ns / (double)obs_get_frame_interval_ns() * 100.0;
+}
+
+static QString source_type_name(obs_source_t *source)
+{
+	if (!source)
+		return {};
+	switch (obs_source_get_type(source)) {
+	case OBS_SOURCE_TYPE_INPUT:
+		return QString::fromUtf8(obs_frontend_get_locale_string("Basic.Main.Source"));
+	case OBS_SOURCE_TYPE_FILTER:
+		return QString::fromUtf8(obs_frontend_get_locale_string("Basic.Filters"));
+	case OBS_SOURCE_TYPE_TRANSITION:
+		return QString::fromUtf8(obs_frontend_get_locale_string("Transition"));
+	case OBS_SOURCE_TYPE_SCENE:
+		if (obs_source_is_group(source))
+			return QString::fromUtf8(obs_frontend_get_locale_string("Group"));
+		return QString::fromUtf8(obs_frontend_get_locale_string("Basic.Scene"));
+	}
+	return {};
+}
+
+/* Rendering more often than this per frame is reported as redundant */
+static const double redundant_render_threshold = 1.05;
+
+/* Every render pass after the first in a frame, on CPU and GPU */
+static uint64_t redundant_render_cost(const profiler_result_t *perf)
+{
+	uint64_t cost = 0;
+	if (perf->render_sum > perf->render_avg)
+		cost += perf->render_sum - perf->render_avg;
+	if (perf->render_gpu_sum > perf->render_gpu_avg)
+		cost += perf->render_gpu_sum - perf->render_gpu_avg;
+	return cost;
+}
+
+struct ReferenceContext {
+	obs_source_t *target;
+	QString path;
+	QStringList *references;
+};
+
+static bool EnumReferenceItem(obs_scene_t *, obs_sceneitem_t *item, void *data)
+{
+	auto ctx = static_cast<ReferenceContext *>(data);
+	obs_source_t *source = obs_sceneitem_get_source(item);
+	if (source == ctx->target)
+		ctx->references->append(ctx->path);
+	if (obs_sceneitem_is_group(item)) {
+		ReferenceContext group = {ctx->target, ctx->path + " / " + QString::fromUtf8(obs_source_get_name(source)),
+					  ctx->references};
+		obs_scene_enum_items(obs_sceneitem_group_get_scene(item), EnumReferenceItem, &group);
+	}
+	return true;
+}
+
+static bool EnumReferenceScene(void *data, obs_source_t *scene)
+{
+	auto ctx = static_cast<ReferenceContext *>(data);
+	ReferenceContext sceneCtx = {ctx->target, QString::fromUtf8(obs_source_get_name(scene)), ctx->references};
+	obs_scene_enum_items(obs_scene_from_source(scene), EnumReferenceItem, &sceneCtx);
+	return true;
+}
+
+/* Scenes and groups that contain the source, or the parent of a filter */
+static QStringList source_references(obs_source_t *source)
+{
+	QStringList references;
+	if (obs_source_get_type(source) == OBS_SOURCE_TYPE_FILTER) {
+		if (obs_source_t *parent = obs_filter_get_parent(source))
+			references.append(QString::fromUtf8(obs_source_get_name(parent)));
+		return references;
+	}
+	ReferenceContext ctx = {source, QString(), &references};
+	obs_enum_scenes(EnumReferenceScene, &ctx);
+	return references;
+}
+
+static bool EnumRedundantRender(void *data, obs_source_t *source)
 {
+	auto found = static_cast<QList<QPair<uint64_t, QStringList>> *>(data);
+	if (!obs_source_showing(source))
+		return true;
+	profiler_result_t perf;
+	if (!source_profiler_fill_result(source, &perf) || !perf.render_avg)
+		return true;
+	double renders = (double)perf.render_sum / (double)perf.render_avg;
+	if (renders <= redundant_render_threshold)
+		return true;
+	uint64_t cpu = perf.render_sum > perf.render_avg ? perf.render_sum - perf.render_avg : 0;
+	uint64_t gpu = perf.render_gpu_sum > perf.render_gpu_avg ? perf.render_gpu_sum - perf.render_gpu_avg : 0;
+	found->append(qMakePair(cpu + gpu, QStringList{QString::fromUtf8(obs_source_get_name(source)),
+						       QString::fromUtf8(obs_source_get_display_name(obs_source_get_unversioned_id(source))),
+						       QString::asprintf("%.02f", renders),
+						       QString::asprintf("%.02f", ns_to_ms(cpu)),
+						       QString::asprintf("%.02f", ns_to_ms(gpu)),
+						       source_references(source).join(", ")}));
+	return true;
 }
 
-static double ns_to_ms(uint64_t ns)
+QList<QStringList> PerfTreeModel::redundantRenders()
 {
-	return (double)ns / 1000000.0;
+	QList<QPair<uint64_t, QStringList>> found;
+	obs_enum_all_sources(EnumRedundantRender, &found);
+	std::sort(found.begin(), found.end(),
+		  [](const QPair<uint64_t, QStringList> &a, const QPair<uint64_t, QStringList> &b) { return a.first > b.first; });
+	QList<QStringList> rows;
+	for (const auto &entry : found)
+		rows.append(entry.second);
+	return rows;
+}
+
+/* Filters count as active when enabled on an active parent */
+static bool source_is_active(obs_source_t *source)
+{
+	if (obs_source_get_type(source) != OBS_SOURCE_TYPE_FILTER)
+		return obs_source_active(source);
+	obs_source_t *parent = obs_filter_get_parent(source);
+	return obs_source_enabled(source) && (!parent || obs_source_active(parent));
 }
 
 PerfTreeModel::PerfTreeModel(QObject *parent) : QAbstractItemModel(parent)
 {
-	columns = {
-		PerfTreeColumn(QString::fromUtf8(obs_module_text("PerfViewer.Name")),
-			       [](const PerfTreeItem *item) { return QVariant(item->name); }),
+	auto has_async = [](const PerfTreeItem *item) { return item->async; };
+	static const PerfTreeColumn column_table[] = {
+		PerfTreeColumn("PerfViewer.Name", [](const PerfTreeItem *item) -> const QString & { return item->name; }),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.SourceDisplayName")),
-			[](const PerfTreeItem *item) { return QVariant(item->sourceDisplayName); }, COLUMN_TYPE_DEFAULT, true),
+			"PerfViewer.SourceDisplayName",
+			[](const PerfTreeItem *item) -> const QString & { return item->sourceDisplayName; }, COLUMN_TYPE_DEFAULT,
+			true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.Active")),
-			[](const PerfTreeItem *item) { return QVariant(item->active); }, COLUMN_TYPE_BOOL, true),
+			"PerfViewer.Active", [](const PerfTreeItem *item) { return item->active; }, COLUMN_TYPE_BOOL, true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.Rendered")),
-			[](const PerfTreeItem *item) { return QVariant(item->rendered); }, COLUMN_TYPE_BOOL, true),
+			"PerfViewer.Rendered", [](const PerfTreeItem *item) { return item->rendered; }, COLUMN_TYPE_BOOL, true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.Enabled")),
-			[](const PerfTreeItem *item) { return QVariant(item->enabled); }, COLUMN_TYPE_BOOL, true),
+			"PerfViewer.Enabled", [](const PerfTreeItem *item) { return item->enabled; }, COLUMN_TYPE_BOOL, true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.TickAvg")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf)
-					return QVariant();
-				return QVariant(ns_to_ms(item->m_perf->tick_avg));
-			},
-			COLUMN_TYPE_DURATION, true),
+			"PerfViewer.TickAvg", [](const PerfTreeItem *item) { return item->m_perf->tick_avg; }, COLUMN_TYPE_DURATION,
+			true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.TickMax")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf)
-					return QVariant();
-				return QVariant(ns_to_ms(item->m_perf->tick_max));
-			},
-			COLUMN_TYPE_DURATION, true),
+			"PerfViewer.TickMax", [](const PerfTreeItem *item) { return item->m_perf->tick_max; }, COLUMN_TYPE_DURATION,
+			true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.RenderAvg")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf)
-					return QVariant();
-				return QVariant(ns_to_ms(item->m_perf->render_avg));
-			},
+			"PerfViewer.RenderAvg", [](const PerfTreeItem *item) { return item->m_perf->render_avg; },
 			COLUMN_TYPE_DURATION, true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.RenderMax")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf)
-					return QVariant();
-				return QVariant(ns_to_ms(item->m_perf->render_max));
-			},
+			"PerfViewer.RenderMax", [](const PerfTreeItem *item) { return item->m_perf->render_max; },
 			COLUMN_TYPE_DURATION, true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.RenderTotal")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf)
-					return QVariant();
-				return QVariant(ns_to_ms(item->m_perf->render_sum));
-			},
+			"PerfViewer.RenderTotal", [](const PerfTreeItem *item) { return item->m_perf->render_sum; },
 			COLUMN_TYPE_DURATION),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.CpuPercentage")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf)
-					return QVariant();
-				return QVariant((double)(item->m_perf->render_sum + item->m_perf->tick_avg) /
-						(double)obs_get_frame_interval_ns() * 100.0);
-			},
+			"PerfViewer.CpuPercentage",
+			[](const PerfTreeItem *item) { return frame_percentage(item->m_perf->render_sum + item->m_perf->tick_avg); },
 			COLUMN_TYPE_PERCENTAGE),
 #ifndef __APPLE__
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.RenderGpuAvg")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf)
-					return QVariant();
-				return QVariant(ns_to_ms(item->m_perf->render_gpu_avg));
-			},
+			"PerfViewer.RenderGpuAvg", [](const PerfTreeItem *item) { return item->m_perf->render_gpu_avg; },
 			COLUMN_TYPE_DURATION, true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.RenderGpuMax")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf)
-					return QVariant();
-				return QVariant(ns_to_ms(item->m_perf->render_gpu_max));
-			},
+			"PerfViewer.RenderGpuMax", [](const PerfTreeItem *item) { return item->m_perf->render_gpu_max; },
 			COLUMN_TYPE_DURATION, true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.RenderGpuTotal")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf)
-					return QVariant();
-				return QVariant(ns_to_ms(item->m_perf->render_gpu_sum));
-			},
+			"PerfViewer.RenderGpuTotal", [](const PerfTreeItem *item) { return item->m_perf->render_gpu_sum; },
 			COLUMN_TYPE_DURATION),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.GpuPercentage")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf)
-					return QVariant();
-				return QVariant((double)item->m_perf->render_gpu_sum / (double)obs_get_frame_interval_ns() * 100.0);
-			},
+			"PerfViewer.GpuPercentage",
+			[](const PerfTreeItem *item) { return frame_percentage(item->m_perf->render_gpu_sum); },
 			COLUMN_TYPE_PERCENTAGE, true),
 #endif
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.AsyncFps")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf || !item->async)
-					return QVariant();
-				return QVariant(item->m_perf->async_input);
-			},
-			COLUMN_TYPE_FPS, true),
+			"PerfViewer.AsyncFps", [](const PerfTreeItem *item) { return item->m_perf->async_input; }, COLUMN_TYPE_FPS,
+			true, has_async),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.AsyncBest")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf || !item->async)
-					return QVariant();
-				return QVariant(ns_to_ms(item->m_perf->async_input_best));
-			},
-			COLUMN_TYPE_INTERVAL, true),
+			"PerfViewer.AsyncBest", [](const PerfTreeItem *item) { return item->m_perf->async_input_best; },
+			COLUMN_TYPE_INTERVAL, true, has_async),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.AsyncWorst")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf || !item->async)
-					return QVariant();
-				return QVariant(ns_to_ms(item->m_perf->async_input_worst));
-			},
-			COLUMN_TYPE_INTERVAL, true),
+			"PerfViewer.AsyncWorst", [](const PerfTreeItem *item) { return item->m_perf->async_input_worst; },
+			COLUMN_TYPE_INTERVAL, true, has_async),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.AsyncRenderedFps")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf || !item->async)
-					return QVariant();
-				return QVariant(item->m_perf->async_rendered);
-			},
-			COLUMN_TYPE_FPS, true),
+			"PerfViewer.AsyncRenderedFps", [](const PerfTreeItem *item) { return item->m_perf->async_rendered; },
+			COLUMN_TYPE_FPS, true, has_async),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.AsyncRenderedBest")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf || !item->async)
-					return QVariant();
-				return QVariant(ns_to_ms(item->m_perf->async_rendered_best));
-			},
-			COLUMN_TYPE_INTERVAL, true),
+			"PerfViewer.AsyncRenderedBest", [](const PerfTreeItem *item) { return item->m_perf->async_rendered_best; },
+			COLUMN_TYPE_INTERVAL, true, has_async),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.AsyncRenderedWorst")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf || !item->async)
-					return QVariant();
-				return QVariant(ns_to_ms(item->m_perf->async_rendered_worst));
-			},
-			COLUMN_TYPE_INTERVAL, true),
+			"PerfViewer.AsyncRenderedWorst", [](const PerfTreeItem *item) { return item->m_perf->async_rendered_worst; },
+			COLUMN_TYPE_INTERVAL, true, has_async),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.Total")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf)
-					return QVariant();
-				return QVariant(
-					ns_to_ms(item->m_perf->tick_avg + item->m_perf->render_sum + item->m_perf->render_gpu_sum));
-			},
+			"PerfViewer.Total", [](const PerfTreeItem *item) { return total_cost(item->m_perf); },
 			COLUMN_TYPE_DURATION),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.TotalPercentage")),
-			[](const PerfTreeItem *item) {
-				if (!item->m_perf)
-					return QVariant();
-				return QVariant(
-					(double)(item->m_perf->tick_avg + item->m_perf->render_sum + item->m_perf->render_gpu_sum) /
-					(double)obs_get_frame_interval_ns() * 100.0);
-			},
+			"PerfViewer.TotalPercentage",
+			[](const PerfTreeItem *item) { return frame_percentage(total_cost(item->m_perf)); },
 			COLUMN_TYPE_PERCENTAGE),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.SubItems")),
-			[](const PerfTreeItem *item) { return QVariant(item->child_count); }, COLUMN_TYPE_COUNT, true),
+			"PerfViewer.SubItems", [](const PerfTreeItem *item) { return (uint64_t)item->child_count; },
+			COLUMN_TYPE_COUNT, true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.Private")),
-			[](const PerfTreeItem *item) { return QVariant(item->is_private); }, COLUMN_TYPE_BOOL, true),
+			"PerfViewer.Private", [](const PerfTreeItem *item) { return item->is_private; }, COLUMN_TYPE_BOOL, true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.SourceType")),
-			[](const PerfTreeItem *item) { return QVariant(item->sourceType); }, COLUMN_TYPE_DEFAULT, true),
+			"PerfViewer.SourceType", [](const PerfTreeItem *item) -> const QString & { return item->sourceType; },
+			COLUMN_TYPE_DEFAULT, true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.Width")),
-			[](const PerfTreeItem *item) {
-				auto s = item->getSource();
-				uint32_t width = obs_source_get_width(s);
-				obs_source_release(s);
-				return QVariant(width);
-			},
-			COLUMN_TYPE_COUNT, true),
+			"PerfViewer.Width", [](const PerfTreeItem *item) { return (uint64_t)item->width; }, COLUMN_TYPE_COUNT, true),
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.Height")),
-			[](const PerfTreeItem *item) {
-				auto s = item->getSource();
-				uint32_t height = obs_source_get_height(s);
-				obs_source_release(s);
-				return QVariant(height);
-			},
-			COLUMN_TYPE_COUNT, true),
+			"PerfViewer.Height", [](const PerfTreeItem *item) { return (uint64_t)item->height; }, COLUMN_TYPE_COUNT,
+			true),
+		PerfTreeColumn("PerfViewer.TotalPercentageGraph", COLUMN_TYPE_GRAPH),
+		// Columns added since are appended, the saved header state restores sections by index
 		PerfTreeColumn(
-			QString::fromUtf8(obs_module_text("PerfViewer.TotalPercentageGraph")),
+			"PerfViewer.PerInstance",
 			[](const PerfTreeItem *item) {
-				UNUSED_PARAMETER(item);
-				return QVariant();
+				if (item->m_childItems.isEmpty())
+					return (uint64_t)0;
+				return total_cost(item->m_perf) / (uint64_t)item->m_childItems.count();
 			},
-			COLUMN_TYPE_GRAPH),
+			COLUMN_TYPE_DURATION, true, [](const PerfTreeItem *item) { return item->is_rollup; }),
+		PerfTreeColumn(
+			"PerfViewer.Shared", [](const PerfTreeItem *item) { return item->shared; }, COLUMN_TYPE_BOOL, true),
+		PerfTreeColumn(
+			"PerfViewer.Share", [](const PerfTreeItem *item) { return item->share * 100.0; }, COLUMN_TYPE_RATIO, true,
+			[](const PerfTreeItem *item) { return item->shared; }),
+		PerfTreeColumn(
+			"PerfViewer.RendersPerFrame", [](const PerfTreeItem *item) { return item->renders_per_frame; },
+			COLUMN_TYPE_RATIO, true),
+		PerfTreeColumn(
+			"PerfViewer.RedundantRender",
+			[](const PerfTreeItem *item) { return item->redundant_render; }, COLUMN_TYPE_DURATION, true,
+			[](const PerfTreeItem *item) { return item->renders_per_frame > redundant_render_threshold; }),
+		PerfTreeColumn(
+			"PerfViewer.Median", [](const PerfTreeItem *item) { return item->p50; }, COLUMN_TYPE_DURATION, true,
+			[](const PerfTreeItem *item) { return item->is_pipeline; }),
+		PerfTreeColumn(
+			"PerfViewer.P95", [](const PerfTreeItem *item) { return item->p95; }, COLUMN_TYPE_DURATION, true,
+			[](const PerfTreeItem *item) { return item->is_pipeline; }),
+		PerfTreeColumn(
+			"PerfViewer.P99", [](const PerfTreeItem *item) { return item->p99; }, COLUMN_TYPE_DURATION, true,
+			[](const PerfTreeItem *item) { return item->is_pipeline; }),
+		PerfTreeColumn(
+			"PerfViewer.AsyncDropped", [](const PerfTreeItem *item) { return item->async_dropped; }, COLUMN_TYPE_FPS,
+			true, has_async),
+		PerfTreeColumn(
+			"PerfViewer.AsyncJitter", [](const PerfTreeItem *item) { return item->async_jitter; },
+			COLUMN_TYPE_PERCENTAGE, true, has_async),
+		PerfTreeColumn(
+			"PerfViewer.AsyncUnderruns", [](const PerfTreeItem *item) { return item->async_underruns; }, COLUMN_TYPE_COUNT,
+			true, has_async),
+		PerfTreeColumn(
+			"PerfViewer.AsyncWasteful", [](const PerfTreeItem *item) { return item->async_wasteful; }, COLUMN_TYPE_BOOL,
+			true, has_async),
+		PerfTreeColumn(
+			"PerfViewer.AsyncHealth", [](const PerfTreeItem *item) { return item->async_health; }, COLUMN_TYPE_SCORE,
+			true, has_async),
 	};
+	for (const auto &column : column_table)
+		columns.append(column);
+	builtinColumns = columns.count();
 
 	auto sh = obs_get_signal_handler();
 	signal_handler_connect(sh, "source_create", source_add, this);
@@ -498,13 +1034,291 @@ QList<int> PerfTreeModel::getDefaultHiddenColumns()
 {
 	QList<int> hiddenColumns;
 	for (int i = 0; i < columns.count(); i++) {
-		auto column = columns.at(i);
-		if (column.DefaultHidden())
+		if (columns.at(i).DefaultHidden())
 			hiddenColumns.append(i);
 	}
 	return hiddenColumns;
 }
 
+void PerfTreeModel::setExpressionColumns(const QList<ExpressionColumn> &expressions)
+{
+	if (columns.count() > builtinColumns) {
+		beginRemoveColumns(QModelIndex(), (int)builtinColumns, (int)columns.count() - 1);
+		columns.resize(builtinColumns);
+		endRemoveColumns();
+	}
+	auto set = std::make_shared<PerfExpressionSet>();
+	for (const auto &expression : expressions)
+		set->append(expression.expression);
+	std::atomic_store(&expressionSet, std::shared_ptr<const PerfExpressionSet>(set));
+	if (expressions.isEmpty())
+		return;
+	beginInsertColumns(QModelIndex(), (int)builtinColumns, (int)(builtinColumns + expressions.count()) - 1);
+	for (int i = 0; i < expressions.count(); i++)
+		columns.append(PerfTreeColumn(expressions.at(i), i));
+	endInsertColumns();
+}
+
+void PerfTreeModel::setBaseline(std::shared_ptr<const PerfBaseline> b)
+{
+	baseline = b;
+	baselineGeneration++;
+	emit headerDataChanged(Qt::Horizontal, 0, (int)columns.count() - 1);
+}
+
+bool PerfTreeModel::applyPinned(PerfTreeItem *item)
+{
+	bool below = false;
+	for (auto child : item->m_childItems) {
+		child->pinned = !child->uuid.isEmpty() && pinned.contains(child->uuid);
+		if (applyPinned(child) || child->pinned)
+			below = true;
+	}
+	item->pinned_below = below;
+	return below;
+}
+
+void PerfTreeModel::setPinned(const PerfTreeItem *item, bool pin)
+{
+	if (item->uuid.isEmpty())
+		return;
+	QMutexLocker locker(&pinnedMutex);
+	if (pin)
+		pinned.insert(item->uuid);
+	else
+		pinned.remove(item->uuid);
+	if (rootItem)
+		applyPinned(rootItem);
+}
+
+QStringList PerfTreeModel::getPinnedSources() const
+{
+	QMutexLocker locker(&pinnedMutex);
+	QStringList uuids;
+	for (const auto &uuid : pinned)
+		uuids.append(uuid);
+	return uuids;
+}
+
+void PerfTreeModel::setPinnedSources(const QStringList &uuids)
+{
+	QMutexLocker locker(&pinnedMutex);
+	pinned.clear();
+	for (const auto &uuid : uuids)
+		pinned.insert(uuid);
+	if (rootItem)
+		applyPinned(rootItem);
+}
+
+void PerfTreeModel::setExpanded(const QModelIndex &index, bool expanded)
+{
+	if (!index.isValid())
+		return;
+	static_cast<PerfTreeItem *>(index.internalPointer())->expanded = expanded;
+}
+
+void PerfTreeModel::captureItem(const PerfTreeItem *item, PerfBaseline &b) const
+{
+	for (auto child : item->m_childItems) {
+		const auto &key = child->baselineKey();
+		if (!key.isEmpty()) {
+			BaselineSource source;
+			source.name = child->name;
+			for (const auto &column : columns) {
+				if (column.Numeric() && column.HasValue(child))
+					source.values.insert(column.Key(), column.Number(child));
+			}
+			b.sources.insert(key, source);
+		}
+		captureItem(child, b);
+	}
+}
+
+PerfBaseline PerfTreeModel::captureBaseline(const QString &name) const
+{
+	PerfBaseline b;
+	b.name = name;
+	b.captured = QDateTime::currentMSecsSinceEpoch();
+	b.showMode = showMode;
+	b.attribution = sharedAttribution;
+	if (rootItem)
+		captureItem(rootItem, b);
+	return b;
+}
+
+bool PerfTreeModel::baselineMatches(const PerfBaseline &b) const
+{
+	return b.showMode == showMode && b.attribution == sharedAttribution;
+}
+
+void PerfTreeModel::dropMismatchedBaseline()
+{
+	if (baseline && !baselineMatches(*baseline))
+		setBaseline(nullptr);
+}
+
+bool PerfTreeModel::baselineDelta(int column, const PerfTreeItem *item, double &delta) const
+{
+	const auto &c = columns.at(column);
+	if (!baseline || !c.Numeric() || !c.HasValue(item))
+		return false;
+	auto base = baseline->find(item->baselineKey());
+	if (!base)
+		return false;
+	auto it = base->values.constFind(c.Key());
+	if (it == base->values.constEnd())
+		return false;
+	delta = c.Number(item) - it.value();
+	return true;
+}
+
+int PerfTreeModel::compare(int column, const PerfTreeItem *left, const PerfTreeItem *right) const
+{
+	const auto &c = columns.at(column);
+	if (!baseline || !c.Numeric())
+		return c.Compare(left, right);
+	double l = 0.0;
+	double r = 0.0;
+	bool lv = baselineDelta(column, left, l);
+	bool rv = baselineDelta(column, right, r);
+	if (!lv || !rv)
+		return (int)lv - (int)rv;
+	return l < r ? -1 : (r < l ? 1 : 0);
+}
+
+void OBSPerfViewer::showExperiments()
+{
+	if (experimentsReport) {
+		experimentsReport->raise();
+		experimentsReport->activateWindow();
+		return;
+	}
+	auto runner = experiments;
+	experimentsReport = new PerfReportDialog(this, QString::fromUtf8(obs_module_text("PerfViewer.Experiments")),
+						 {QString::fromUtf8(obs_module_text("PerfViewer.Name")),
+						  QString::fromUtf8(obs_module_text("PerfViewer.ExperimentStatus")),
+						  QString::fromUtf8(obs_module_text("PerfViewer.ExperimentParentSaving")),
+						  QString::fromUtf8(obs_module_text("PerfViewer.ExperimentFrameSaving"))},
+						 [runner] { return runner->results(); }, 500);
+}
+
+void OBSPerfViewer::showRegressions()
+{
+	if (regressionsReport) {
+		regressionsReport->raise();
+		return;
+	}
+	auto tracker = regressionTracker;
+	regressionsReport = new PerfReportDialog(this, QString::fromUtf8(obs_module_text("PerfViewer.Regressions")),
+						 {QString::fromUtf8(obs_module_text("PerfViewer.Name")),
+						  QString::fromUtf8(obs_module_text("PerfViewer.SourceDisplayName")),
+						  QString::fromUtf8(obs_module_text("PerfViewer.RegressionCurrent")),
+						  QString::fromUtf8(obs_module_text("PerfViewer.RegressionUsual")),
+						  QString::fromUtf8(obs_module_text("PerfViewer.RegressionSessions")),
+						  QString::fromUtf8(obs_module_text("PerfViewer.RegressionScore"))},
+						 [tracker] { return tracker->results(); });
+}
+
+void OBSPerfViewer::showCollectionLoad()
+{
+	auto profiler = loadProfiler;
+	new PerfReportDialog(this, profiler->title(),
+			     {QString::fromUtf8(obs_module_text("PerfViewer.Name")),
+			      QString::fromUtf8(obs_module_text("PerfViewer.SourceDisplayName")),
+			      QString::fromUtf8(obs_module_text("PerfViewer.LoadCreated")),
+			      QString::fromUtf8(obs_module_text("PerfViewer.LoadFirstTick")),
+			      QString::fromUtf8(obs_module_text("PerfViewer.LoadFirstRender"))},
+			     [profiler] { return profiler->results(); });
+}
+
+void OBSPerfViewer::setExpressions(const QList<ExpressionColumn> &columns)
+{
+	int first = model->columnCount() - (int)expressions.count();
+	expressions = columns;
+	model->setExpressionColumns(expressions);
+	advisor->setAlerts(expressions);
+	for (int i = first; i < model->columnCount(); i++)
+		treeView->resizeColumnToContents(i);
+}
+
+void OBSPerfViewer::syncExpanded(const QModelIndex &parent)
+{
+	for (int row = 0; row < proxy->rowCount(parent); row++) {
+		auto index = proxy->index(row, 0, parent);
+		model->setExpanded(proxy->mapToSource(index), treeView->isExpanded(index));
+		syncExpanded(index);
+	}
+}
+
+void OBSPerfViewer::updateBaselineMenu()
+{
+	baselineMenu->clear();
+	auto collection = baseline_collection();
+	auto names = PerfBaseline::names(collection);
+	auto current = model->getBaseline();
+
+	auto captureAction = baselineMenu->addAction(QString::fromUtf8(obs_module_text("PerfViewer.BaselineCapture")));
+	connect(captureAction, &QAction::triggered, this, [this, collection] {
+		bool ok = false;
+		auto name = QInputDialog::getText(this, QString::fromUtf8(obs_module_text("PerfViewer.BaselineCapture")),
+						  QString::fromUtf8(obs_module_text("PerfViewer.BaselineName")), QLineEdit::Normal,
+						  QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm"), &ok)
+				    .trimmed();
+		if (!ok || name.isEmpty())
+			return;
+		if (!model->captureBaseline(name).save(collection))
+			QMessageBox::warning(this, QString::fromUtf8(obs_module_text("PerfViewer.Baseline")),
+					     QString::fromUtf8(obs_module_text("PerfViewer.BaselineSaveFailed")));
+	});
+	baselineMenu->addSeparator();
+
+	auto noneAction = baselineMenu->addAction(QString::fromUtf8(obs_module_text("PerfViewer.BaselineNone")));
+	noneAction->setCheckable(true);
+	noneAction->setChecked(!current);
+	connect(noneAction, &QAction::triggered, this, [this] {
+		model->setBaseline(nullptr);
+		treeView->viewport()->update();
+	});
+	for (const auto &name : names) {
+		auto a = baselineMenu->addAction(name);
+		a->setCheckable(true);
+		a->setChecked(current && current->name == name);
+		connect(a, &QAction::triggered, this, [this, collection, name] {
+			auto b = std::make_shared<PerfBaseline>();
+			if (!PerfBaseline::load(collection, name, *b))
+				return;
+			if (!model->baselineMatches(*b)) {
+				QMessageBox::warning(this, QString::fromUtf8(obs_module_text("PerfViewer.Baseline")),
+						     QString::fromUtf8(obs_module_text("PerfViewer.BaselineModeMismatch")).arg(name));
+				return;
+			}
+			model->setBaseline(b);
+			treeView->viewport()->update();
+		});
+	}
+	if (names.isEmpty())
+		return;
+
+	baselineMenu->addSeparator();
+	auto deleteMenu = baselineMenu->addMenu(QString::fromUtf8(obs_module_text("PerfViewer.BaselineDelete")));
+	for (const auto &name : names) {
+		auto a = deleteMenu->addAction(name);
+		connect(a, &QAction::triggered, this, [this, collection, name] {
+			if (QMessageBox::question(this, QString::fromUtf8(obs_module_text("PerfViewer.BaselineDelete")),
+						  QString::fromUtf8(obs_module_text("PerfViewer.BaselineDeleteConfirm")).arg(name)) !=
+			    QMessageBox::Yes)
+				return;
+			PerfBaseline::remove(collection, name);
+			// Stop comparing against a baseline that no longer exists
+			auto current = model->getBaseline();
+			if (current && current->name == name) {
+				model->setBaseline(nullptr);
+				treeView->viewport()->update();
+			}
+		});
+	}
+}
+
 void OBSPerfViewer::sourceListUpdated()
 {
 	if (loaded)
@@ -644,28 +1458,363 @@ bool PerfTreeModel::EnumNotPrivateSource(void *data, obs_source_t *source)
 	return EnumAllSource(data, source);
 }
 
-bool PerfTreeModel::EnumAll(void *data, obs_source_t *source)
+bool PerfTreeModel::EnumAll(void *data, obs_source_t *source)
+{
+	if (obs_source_get_type(source) == OBS_SOURCE_TYPE_FILTER) {
+		EnumFilter(nullptr, source, data);
+		return true;
+	}
+	return EnumAllSource(data, source);
+}
+
+bool PerfTreeModel::EnumFilterSource(void *data, obs_source_t *source)
+{
+	if (obs_source_get_type(source) != OBS_SOURCE_TYPE_FILTER)
+		return true;
+	EnumFilter(nullptr, source, data);
+	return true;
+}
+
+bool PerfTreeModel::EnumTransition(void *data, obs_source_t *source)
+{
+	if (obs_source_get_type(source) != OBS_SOURCE_TYPE_TRANSITION)
+		return true;
+	return EnumAllSource(data, source);
+}
+
+struct HotspotContext {
+	PerfTreeModel *model;
+	/* Min-heap on value, holds at most hotspotCount entries */
+	std::vector<std::pair<double, obs_weak_source_t *>> heap;
+	profiler_result_t perf;
+};
+
+static bool hotspot_greater(const std::pair<double, obs_weak_source_t *> &a, const std::pair<double, obs_weak_source_t *> &b)
+{
+	return a.first > b.first;
+}
+
+static double hotspot_value(enum PerfTreeModel::HotspotMetric metric, const profiler_result_t *perf)
+{
+	switch (metric) {
+	case PerfTreeModel::HOTSPOT_CPU:
+		return frame_percentage(perf->render_sum + perf->tick_avg);
+	case PerfTreeModel::HOTSPOT_GPU:
+		return frame_percentage(perf->render_gpu_sum);
+	case PerfTreeModel::HOTSPOT_TICK_MAX:
+		return ns_to_ms(perf->tick_max);
+	case PerfTreeModel::HOTSPOT_RENDER_MAX:
+		return ns_to_ms(perf->render_max);
+	default:
+		return frame_percentage(total_cost(perf));
+	}
+}
+
+bool PerfTreeModel::EnumHotspot(void *data, obs_source_t *source)
+{
+	auto ctx = static_cast<HotspotContext *>(data);
+	if (source_aggregates_items(source))
+		return true;
+	if (ctx->model->activeOnly && !source_is_active(source))
+		return true;
+	if (!source_profiler_fill_result(source, &ctx->perf))
+		return true;
+	if (obs_source_get_type(source) == OBS_SOURCE_TYPE_FILTER)
+		filter_exclusive_result(source, &ctx->perf);
+
+	double value = hotspot_value(ctx->model->hotspotMetric, &ctx->perf);
+	if (value <= 0.0)
+		return true;
+	auto &heap = ctx->heap;
+	if ((int)heap.size() < ctx->model->hotspotCount) {
+		heap.emplace_back(value, obs_source_get_weak_source(source));
+		std::push_heap(heap.begin(), heap.end(), hotspot_greater);
+	} else if (!heap.empty() && value > heap.front().first) {
+		std::pop_heap(heap.begin(), heap.end(), hotspot_greater);
+		obs_weak_source_release(heap.back().second);
+		heap.back() = {value, obs_source_get_weak_source(source)};
+		std::push_heap(heap.begin(), heap.end(), hotspot_greater);
+	}
+	return true;
+}
+
+void PerfTreeModel::updateHotspots()
+{
+	if (refreshing || !rootItem)
+		return;
+
+	// Sources are unique in the global list, so a source shown in several scenes is ranked once
+	HotspotContext ctx = {this, {}, {}};
+	ctx.heap.reserve(hotspotCount + 1);
+	obs_enum_all_sources(EnumHotspot, &ctx);
+
+	for (int i = rootItem->childCount() - 1; i >= 0; i--) {
+		auto item = rootItem->child(i);
+		auto found = std::find_if(ctx.heap.begin(), ctx.heap.end(),
+					  [item](const std::pair<double, obs_weak_source_t *> &entry) {
+						  return item->m_source == entry.second;
+					  });
+		if (found != ctx.heap.end())
+			continue;
+		beginRemoveRows(QModelIndex(), i, i);
+		rootItem->m_childItems.removeAt(i);
+		endRemoveRows();
+		item->disconnect();
+		obs_queue_task(OBS_TASK_UI, [](void *d) { delete (PerfTreeItem *)d; }, item, false);
+	}
+
+	for (const auto &entry : ctx.heap) {
+		bool exists = false;
+		for (auto item : rootItem->m_childItems) {
+			if (item->m_source == entry.second) {
+				exists = true;
+				break;
+			}
+		}
+		obs_source_t *source = exists ? nullptr : obs_weak_source_get_source(entry.second);
+		if (source) {
+			auto pos = rowCount();
+			beginInsertRows(QModelIndex(), pos, pos);
+			rootItem->appendChild(new PerfTreeItem(source, rootItem, this));
+			endInsertRows();
+			obs_source_release(source);
+		}
+		obs_weak_source_release(entry.second);
+	}
+}
+
+PerfTreeItem *PerfTreeModel::typeGroup(obs_source_t *source, bool notify)
+{
+	auto id = QString::fromUtf8(obs_source_get_unversioned_id(source));
+	for (auto item : rootItem->m_childItems) {
+		if (item->is_rollup && item->rollupId == id)
+			return item;
+	}
+	auto pos = rootItem->childCount();
+	if (notify)
+		beginInsertRows(QModelIndex(), pos, pos);
+	auto group = new PerfTreeItem((obs_source_t *)nullptr, rootItem, this);
+	group->is_rollup = true;
+	group->rollupId = id;
+	group->name = QString::fromUtf8(obs_source_get_display_name(obs_source_get_unversioned_id(source)));
+	group->sourceDisplayName = group->name;
+	group->sourceType = source_type_name(source);
+	group->searchName = group->name.toCaseFolded();
+	group->searchType = (group->name + " " + id + " " + group->sourceType).toCaseFolded();
+	group->icon = group->getIcon(source);
+	rootItem->appendChild(group);
+	if (notify)
+		endInsertRows();
+	return group;
+}
+
+bool PerfTreeModel::EnumSourceType(void *data, obs_source_t *source)
+{
+	auto model = static_cast<PerfTreeModel *>(data);
+	if (source_aggregates_items(source))
+		return true;
+	if (model->activeOnly && !source_is_active(source))
+		return true;
+	auto group = model->typeGroup(source, false);
+	group->appendChild(new PerfTreeItem(source, group, model));
+	return true;
+}
+
+static void collect_references(PerfTreeItem *item, QHash<obs_weak_source_t *, QList<PerfTreeItem *>> &references)
+{
+	for (int i = 0; i < item->childCount(); i++) {
+		auto child = item->child(i);
+		references[child->weakSource()].append(child);
+		collect_references(child, references);
+	}
+}
+
+void PerfTreeModel::updateShares()
+{
+	QHash<obs_weak_source_t *, QList<PerfTreeItem *>> references;
+	collect_references(rootItem, references);
+
+	for (auto it = references.begin(); it != references.end(); ++it) {
+		auto &items = it.value();
+		if (!it.key() || items.count() < 2) {
+			for (auto item : items) {
+				item->share = 1.0;
+				item->shared = false;
+			}
+			continue;
+		}
+		// Copies of a nested scene repeat the same scene items, so a reference is
+		// identified by its parent source and scene item rather than by its row.
+		// Root level rows have no parent to attribute to and are not counted.
+		QHash<QPair<obs_weak_source_t *, obs_sceneitem_t *>, double> weights;
+		for (auto item : items) {
+			auto parent = item->m_parentItem;
+			if (parent == rootItem)
+				continue;
+			auto key = qMakePair(parent ? parent->m_source : nullptr, item->m_sceneitem);
+			double weight = 1.0;
+			if (sharedAttribution == SHARED_RENDER_WEIGHTED)
+				weight = parent && parent->rendered ? parent->renders_per_frame : 0.0;
+			weights[key] = std::max(weights.value(key), weight);
+		}
+		double total = 0.0;
+		for (auto weight : weights)
+			total += weight;
+		bool shared = weights.count() > 1;
+		for (auto item : items) {
+			item->shared = shared;
+			if (!shared || sharedAttribution == SHARED_FULL || item->m_parentItem == rootItem) {
+				item->share = 1.0;
+				continue;
+			}
+			auto parent = item->m_parentItem;
+			auto key = qMakePair(parent ? parent->m_source : nullptr, item->m_sceneitem);
+			item->share = total > 0.0 ? weights.value(key) / total : 1.0 / (double)weights.count();
+		}
+	}
+}
+
+struct PipelineContext {
+	PerfTreeModel *model;
+	PerfTreeItem *parent;
+	QString path;
+	/* Time since the previous snapshot in ns */
+	uint64_t window;
+	/* Rows are inserted into a shown tree */
+	bool notify;
+};
+
+bool PerfTreeModel::EnumPipelineItem(void *data, profiler_snapshot_entry_t *entry)
 {
-	if (obs_source_get_type(source) == OBS_SOURCE_TYPE_FILTER) {
-		EnumFilter(nullptr, source, data);
-		return true;
+	auto ctx = static_cast<PipelineContext *>(data);
+	auto name = QString::fromUtf8(profiler_snapshot_entry_name(entry));
+	auto path = ctx->path + "/" + name;
+	PerfTreeItem *item = nullptr;
+	for (auto child : ctx->parent->m_childItems) {
+		if (child->pipelinePath == path) {
+			item = child;
+			break;
+		}
 	}
-	return EnumAllSource(data, source);
+	if (!item) {
+		item = new PerfTreeItem((obs_source_t *)nullptr, ctx->parent, ctx->model);
+		item->is_pipeline = true;
+		item->name = name;
+		item->pipelinePath = path;
+		item->sourceDisplayName = ctx->parent->sourceDisplayName;
+		item->searchName = item->name.toCaseFolded();
+		item->searchType = ctx->parent->searchType;
+		item->active = item->rendered = item->enabled = true;
+		auto pos = ctx->parent->childCount();
+		if (ctx->notify)
+			ctx->model->beginInsertRows(ctx->model->createIndex(ctx->parent->row(), 0, ctx->parent), pos, pos);
+		ctx->parent->appendChild(item);
+		if (ctx->notify)
+			ctx->model->endInsertRows();
+	}
+	PipelineContext child = {ctx->model, item, item->pipelinePath, 0, ctx->notify};
+	profiler_snapshot_enumerate_children(entry, EnumPipelineItem, &child);
+	return true;
 }
 
-bool PerfTreeModel::EnumFilterSource(void *data, obs_source_t *source)
+/* Adds the Pipeline root or the stages missing under it */
+void PerfTreeModel::addPipeline()
 {
-	if (obs_source_get_type(source) != OBS_SOURCE_TYPE_FILTER)
-		return true;
-	EnumFilter(nullptr, source, data);
+	PerfTreeItem *root = nullptr;
+	for (auto item : rootItem->m_childItems) {
+		if (item->is_pipeline) {
+			root = item;
+			break;
+		}
+	}
+	bool notify = root != nullptr;
+	if (!root) {
+		root = new PerfTreeItem((obs_source_t *)nullptr, rootItem, this);
+		root->is_pipeline = true;
+		root->name = QString::fromUtf8(obs_module_text("PerfViewer.Pipeline"));
+		root->sourceDisplayName = root->name;
+		root->searchName = root->name.toCaseFolded();
+		root->searchType = root->searchName;
+		root->active = root->rendered = root->enabled = true;
+		rootItem->prependChild(root);
+	}
+
+	profiler_snapshot_t *snap = profile_snapshot_create();
+	PipelineContext ctx = {this, root, QString(), 0, notify};
+	profiler_snapshot_enumerate(snap, EnumPipelineItem, &ctx);
+	profile_snapshot_free(snap);
+}
+
+bool PerfTreeModel::EnumPipelineStage(void *data, profiler_snapshot_entry_t *entry)
+{
+	auto ctx = static_cast<PipelineContext *>(data);
+	auto path = ctx->path + "/" + QString::fromUtf8(profiler_snapshot_entry_name(entry));
+	auto &counts = ctx->model->pipelineCounts[path];
+
+	// Calls since the previous snapshot per duration in us
+	QList<QPair<uint64_t, uint64_t>> calls;
+	uint64_t count = 0;
+	uint64_t total = 0;
+	auto times = profiler_snapshot_entry_times(entry);
+	for (size_t i = 0; i < times->num; i++) {
+		auto &time = times->array[i];
+		auto &previous = counts[time.time_delta];
+		if (time.count > previous) {
+			calls.append(qMakePair(time.time_delta, time.count - previous));
+			count += time.count - previous;
+			total += time.time_delta * (time.count - previous);
+		}
+		previous = time.count;
+	}
+
+	PipelineStage stage;
+	if (count && ctx->window) {
+		std::sort(calls.begin(), calls.end(), [](const QPair<uint64_t, uint64_t> &a, const QPair<uint64_t, uint64_t> &b) {
+			return a.first < b.first;
+		});
+		stage.avg = total * 1000 / count;
+		stage.max = calls.last().first * 1000;
+		stage.sum = (uint64_t)((double)total * 1000.0 * (double)obs_get_frame_interval_ns() / (double)ctx->window);
+		uint64_t seen = 0;
+		uint64_t p50_rank = (count + 1) / 2, p95_rank = (count * 95 + 99) / 100, p99_rank = (count * 99 + 99) / 100;
+		for (const auto &call : calls) {
+			seen += call.second;
+			if (!stage.p50 && seen >= p50_rank)
+				stage.p50 = call.first * 1000;
+			if (!stage.p95 && seen >= p95_rank)
+				stage.p95 = call.first * 1000;
+			if (!stage.p99 && seen >= p99_rank) {
+				stage.p99 = call.first * 1000;
+				break;
+			}
+		}
+	}
+	if (!ctx->model->pipelineStages.contains(path))
+		ctx->model->pipelineAdded = true;
+	ctx->model->pipelineStages[path] = stage;
+
+	PipelineContext child = {ctx->model, nullptr, path, ctx->window, false};
+	profiler_snapshot_enumerate_children(entry, EnumPipelineStage, &child);
 	return true;
 }
 
-bool PerfTreeModel::EnumTransition(void *data, obs_source_t *source)
+void PerfTreeModel::updatePipeline()
 {
-	if (obs_source_get_type(source) != OBS_SOURCE_TYPE_TRANSITION)
-		return true;
-	return EnumAllSource(data, source);
+	// The first snapshot only sets the baseline, its counts cover the whole session
+	uint64_t now = os_gettime_ns();
+	PipelineContext ctx = {this, nullptr, QString(), pipelineTime ? now - pipelineTime : 0, false};
+	pipelineTime = now;
+	pipelineAdded = false;
+	profiler_snapshot_t *snap = profile_snapshot_create();
+	profiler_snapshot_enumerate(snap, EnumPipelineStage, &ctx);
+	profile_snapshot_free(snap);
+	if (!pipelineAdded)
+		return;
+	// Stages that first ran after the rows were built, like those of an output that just started
+	if (QThread::currentThread() == thread())
+		addPipeline();
+	else
+		obs_queue_task(OBS_TASK_UI, [](void *d) { static_cast<PerfTreeModel *>(d)->addPipeline(); }, this, true);
 }
 
 void PerfTreeModel::refreshSources()
@@ -712,7 +1861,12 @@ void PerfTreeModel::refreshSources()
 		obs_enum_all_sources(EnumFilterSource, rootItem);
 	} else if (showMode == ShowMode::TRANSITION) {
 		obs_enum_all_sources(EnumTransition, rootItem);
+	} else if (showMode == ShowMode::TYPES) {
+		obs_enum_all_sources(EnumSourceType, this);
 	}
+	// Hotspot rows are filled by updateHotspots on every pass
+	if (showPipeline && showMode != ShowMode::HOTSPOTS)
+		addPipeline();
 	endResetModel();
 	refreshing = false;
 	updateData();
@@ -725,22 +1879,297 @@ void PerfTreeModel::updateData()
 	// Set target frame time in ms
 	frameTime = ns_to_ms(obs_get_frame_interval_ns());
 
-	if (rootItem)
+	if (showMode == ShowMode::HOTSPOTS) {
+		if (QThread::currentThread() == thread())
+			updateHotspots();
+		else
+			obs_queue_task(OBS_TASK_UI, [](void *d) { static_cast<PerfTreeModel *>(d)->updateHotspots(); }, this, true);
+	}
+
+	if (showPipeline && showMode != ShowMode::HOTSPOTS)
+		updatePipeline();
+
+	markerPass = pendingMarkers.exchange(0) > 0;
+
+	updateSamples();
+
+	if (rootItem) {
+		passExpressions = std::atomic_load(&expressionSet);
+		updateShares();
 		rootItem->update();
+		QMutexLocker locker(&searchMutex);
+		publishSearchIndex(rootItem);
+	}
+
+	emit updated();
+}
+
+void PerfTreeModel::publishSearchIndex(PerfTreeItem *item)
+{
+	item->search_published = item->search_index;
+	for (auto child : item->m_childItems)
+		publishSearchIndex(child);
+}
+
+static const struct {
+	const char *name;
+	enum PerfSearchField field;
+} search_fields[] = {
+	{"cpu", SEARCH_CPU},           {"gpu", SEARCH_GPU},          {"total", SEARCH_TOTAL},
+	{"tick", SEARCH_TICK},         {"tickmax", SEARCH_TICK_MAX}, {"render", SEARCH_RENDER},
+	{"fps", SEARCH_FPS},           {"width", SEARCH_WIDTH},      {"height", SEARCH_HEIGHT},
+	{"async", SEARCH_ASYNC},       {"active", SEARCH_ACTIVE},    {"rendered", SEARCH_RENDERED},
+	{"enabled", SEARCH_ENABLED},   {"private", SEARCH_PRIVATE},  {"filter", SEARCH_FILTER},
+	{"wasteful", SEARCH_WASTEFUL}, {"name", SEARCH_NAME},        {"type", SEARCH_TYPE},
+	{"scene", SEARCH_SCENE},
+};
+
+void PerfSearch::parse(const QString &filter)
+{
+	terms.clear();
+	dynamic = false;
+	for (const auto &token : filter.simplified().split(QChar(' '))) {
+		if (token.isEmpty())
+			continue;
+		PerfSearchTerm term = {SEARCH_NAME, SEARCH_OP_CONTAINS, 0.0, token.toCaseFolded()};
+		qsizetype pos = 0;
+		while (pos < token.size() && token.at(pos) != ':' && token.at(pos) != '>' && token.at(pos) != '<' &&
+		       token.at(pos) != '=' && token.at(pos) != '!')
+			pos++;
+		if (pos == 0 || pos >= token.size()) {
+			terms.append(term);
+			continue;
+		}
+		auto key = token.left(pos).toLower();
+		if (key.endsWith("%"))
+			key = key.left(key.size() - 1);
+		bool found = false;
+		for (const auto &search_field : search_fields) {
+			if (key == QString::fromUtf8(search_field.name)) {
+				term.field = search_field.field;
+				found = true;
+				break;
+			}
+		}
+		if (!found) {
+			terms.append(term);
+			continue;
+		}
+		auto c = token.at(pos);
+		bool equals = pos + 1 < token.size() && token.at(pos + 1) == '=' && c != '=' && c != ':';
+		if (c == '>') {
+			term.op = equals ? SEARCH_OP_GE : SEARCH_OP_GT;
+		} else if (c == '<') {
+			term.op = equals ? SEARCH_OP_LE : SEARCH_OP_LT;
+		} else if (c == '!') {
+			term.op = SEARCH_OP_NE;
+		} else if (c == ':' && term.field < SEARCH_NUMERIC_COUNT) {
+			// "cpu:5" reads as "at least 5"
+			term.op = SEARCH_OP_GE;
+		} else {
+			term.op = SEARCH_OP_EQ;
+		}
+		auto value = token.mid(pos + (equals ? 2 : 1));
+		if (term.field >= SEARCH_NAME) {
+			term.op = SEARCH_OP_CONTAINS;
+			term.text = value.toCaseFolded();
+		} else if (term.field >= SEARCH_NUMERIC_COUNT) {
+			auto v = value.toLower();
+			term.value = (v == "true" || v == "yes" || v == "on" || v == "1") ? 1.0 : 0.0;
+			if (term.op != SEARCH_OP_NE)
+				term.op = SEARCH_OP_EQ;
+			// Whether a source is private, a filter or async does not change while it exists
+			if (term.field != SEARCH_PRIVATE && term.field != SEARCH_FILTER && term.field != SEARCH_ASYNC)
+				dynamic = true;
+		} else {
+			bool ok = false;
+			term.value = value.toDouble(&ok);
+			if (!ok)
+				continue;
+			dynamic = true;
+		}
+		terms.append(term);
+	}
+}
+
+static bool search_compare(double value, enum PerfSearchOp op, double target)
+{
+	switch (op) {
+	case SEARCH_OP_EQ:
+		return value == target;
+	case SEARCH_OP_NE:
+		return value != target;
+	case SEARCH_OP_GT:
+		return value > target;
+	case SEARCH_OP_GE:
+		return value >= target;
+	case SEARCH_OP_LT:
+		return value < target;
+	case SEARCH_OP_LE:
+		return value <= target;
+	default:
+		return false;
+	}
+}
+
+bool PerfSearch::matches(const PerfTreeItem *item) const
+{
+	for (const auto &term : terms) {
+		if (term.field == SEARCH_NAME) {
+			if (!item->searchName.contains(term.text))
+				return false;
+		} else if (term.field == SEARCH_TYPE) {
+			if (!item->searchType.contains(term.text))
+				return false;
+		} else if (term.field == SEARCH_SCENE) {
+			if (!item->searchScene.contains(term.text))
+				return false;
+		} else if (term.field >= SEARCH_NUMERIC_COUNT) {
+			double flag = (item->search_published.flags >> (term.field - SEARCH_NUMERIC_COUNT)) & 1 ? 1.0 : 0.0;
+			if (!search_compare(flag, term.op, term.value))
+				return false;
+		} else if (!search_compare(item->search_published.metrics[term.field], term.op, term.value)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PerfSearch::subtreeMayMatch(const PerfTreeItem *item) const
+{
+	const auto &index = item->search_published;
+	for (const auto &term : terms) {
+		if (term.field >= SEARCH_NAME)
+			continue;
+		if (term.field >= SEARCH_NUMERIC_COUNT) {
+			uint32_t bit = 1u << (term.field - SEARCH_NUMERIC_COUNT);
+			bool wanted = (term.value != 0.0) == (term.op != SEARCH_OP_NE);
+			if (!((wanted ? index.subtree_true : index.subtree_false) & bit))
+				return false;
+			continue;
+		}
+		double min = index.subtree_min[term.field];
+		double max = index.subtree_max[term.field];
+		switch (term.op) {
+		case SEARCH_OP_GT:
+		case SEARCH_OP_GE:
+			if (!search_compare(max, term.op, term.value))
+				return false;
+			break;
+		case SEARCH_OP_LT:
+		case SEARCH_OP_LE:
+			if (!search_compare(min, term.op, term.value))
+				return false;
+			break;
+		case SEARCH_OP_EQ:
+			if (term.value < min || term.value > max)
+				return false;
+			break;
+		default:
+			break;
+		}
+	}
+	return true;
 }
 
 void PerfViewerProxyModel::setFilterText(const QString &filter)
 {
-	QRegularExpression regex(filter, QRegularExpression::CaseInsensitiveOption);
-	setFilterRegularExpression(regex);
+	search.parse(filter);
+	searchGeneration++;
+	invalidateFilter();
 }
 
-bool PerfViewerProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+bool PerfViewerProxyModel::accepts(PerfTreeItem *item) const
+{
+	if (item->search_generation == searchGeneration)
+		return item->search_result;
+	bool result = search.matches(item);
+	if (!result && search.subtreeMayMatch(item)) {
+		for (auto child : item->m_childItems) {
+			if (accepts(child)) {
+				result = true;
+				break;
+			}
+		}
+	}
+	item->search_generation = searchGeneration;
+	item->search_result = result;
+	return result;
+}
+
+bool PerfViewerProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
+{
+	auto model = static_cast<PerfTreeModel *>(sourceModel());
+	auto leftItem = static_cast<const PerfTreeItem *>(left.internalPointer());
+	auto rightItem = static_cast<const PerfTreeItem *>(right.internalPointer());
+	if (!leftItem || !rightItem || left.column() != right.column())
+		return QSortFilterProxyModel::lessThan(left, right);
+	return model->compare(left.column(), leftItem, rightItem) < 0;
+}
+
+bool PerfViewerProxyModel::crossedNeighbor(const QModelIndex &parent) const
+{
+	auto model = static_cast<PerfTreeModel *>(sourceModel());
+	const auto &column = model->column(sortColumn());
+	// Changes against a baseline are ranked through the model's comparison
+	bool numeric = column.Numeric() && !model->getBaseline();
+	const PerfTreeItem *prev = nullptr;
+	int count = rowCount(parent);
+	for (int i = 0; i < count; i++) {
+		auto proxyIndex = index(i, 0, parent);
+		auto item = static_cast<const PerfTreeItem *>(mapToSource(proxyIndex).internalPointer());
+		if (prev) {
+			if (numeric && column.HasValue(prev) && column.HasValue(item)) {
+				double l = column.Number(prev);
+				double r = column.Number(item);
+				double crossed = sortOrder() == Qt::AscendingOrder ? l - r : r - l;
+				if (crossed > rankHysteresis * std::max(std::abs(l), std::abs(r)))
+					return true;
+			} else {
+				int c = model->compare(sortColumn(), prev, item);
+				if (sortOrder() == Qt::AscendingOrder ? c > 0 : c < 0)
+					return true;
+			}
+		}
+		if (crossedNeighbor(proxyIndex))
+			return true;
+		prev = item;
+	}
+	return false;
+}
+
+void PerfViewerProxyModel::rowsAdded()
 {
-	QModelIndex itemIndex = sourceModel()->index(sourceRow, 0, sourceParent);
+	rowsChanged = true;
+}
+
+void PerfViewerProxyModel::dataUpdated()
+{
+	if (!search.isEmpty() && (search.isDynamic() || rowsChanged)) {
+		searchGeneration++;
+		invalidateRowsFilter();
+	}
+	rowsChanged = false;
+	if (sortColumn() < 0)
+		return;
+	if (rankInterval > 0 && lastRank.elapsed() < rankInterval)
+		return;
+	// Skip the re-sort when nothing crossed. A single crossing anywhere still re-sorts the whole tree.
+	if (!crossedNeighbor(QModelIndex()))
+		return;
+	lastRank.restart();
+	sort(sortColumn(), sortOrder());
+}
 
-	auto name = sourceModel()->data(itemIndex, Qt::DisplayRole).toString();
-	return name.contains(filterRegularExpression());
+bool PerfViewerProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+	if (search.isEmpty())
+		return true;
+	auto model = static_cast<PerfTreeModel *>(sourceModel());
+	QModelIndex itemIndex = model->index(sourceRow, 0, sourceParent);
+	auto item = static_cast<PerfTreeItem *>(itemIndex.internalPointer());
+	QMutexLocker locker(&model->searchMutex);
+	return item && accepts(item);
 }
 
 PerfTreeModel::~PerfTreeModel()
@@ -763,6 +2192,139 @@ PerfTreeModel::~PerfTreeModel()
 	signal_handler_disconnect(sh, "source_deactivate", source_deactivate, this);
 
 	delete rootItem;
+
+	for (auto it = samples.begin(); it != samples.end(); ++it)
+		obs_weak_source_release(it.key());
+	for (auto it = history.begin(); it != history.end(); ++it) {
+		obs_weak_source_release(it.key());
+		delete it.value();
+	}
+}
+
+/* Sources costing this share of the frame interval are sampled on every pass */
+#define SCHEDULE_HOT 0.02
+/* Change in cost since the previous sample, as a share of the frame interval, that counts as changed */
+#define SCHEDULE_CHANGE 0.005
+/* Longest back-off of quiet sources in passes */
+#define SCHEDULE_MAX_INTERVAL 8
+
+/* Hot sources are sampled every pass, quiet ones twice as rarely after every sample */
+void PerfTreeModel::refreshSample(obs_source_t *source, PerfSourceSample &sample)
+{
+	uint64_t old_total = total_cost(&sample.exclusive);
+	bool was_active = sample.active;
+	sample.kind = obs_source_get_type(source);
+	sample.active = source_is_active(source);
+	if (!source_profiler_fill_result(source, &sample.perf))
+		memset(&sample.perf, 0, sizeof(profiler_result_t));
+	sample.exclusive = sample.perf;
+	if (sample.kind == OBS_SOURCE_TYPE_FILTER)
+		filter_exclusive_result(source, &sample.exclusive);
+
+	uint64_t total = total_cost(&sample.exclusive);
+	double frame = (double)obs_get_frame_interval_ns();
+	bool hot = sample.pinned || !sample.pass || sample.active != was_active || (double)total >= frame * SCHEDULE_HOT ||
+		   std::abs((double)total - (double)old_total) >= frame * SCHEDULE_CHANGE;
+	sample.interval = hot ? 1 : std::min(sample.interval * 2, SCHEDULE_MAX_INTERVAL);
+	sample.skip = sample.interval - 1;
+	sample.pass = samplePass;
+}
+
+bool PerfTreeModel::EnumSample(void *data, obs_source_t *source)
+{
+	auto model = static_cast<PerfTreeModel *>(data);
+	obs_weak_source_t *weak = obs_source_get_weak_source(source);
+	auto it = model->samples.find(weak);
+	if (it == model->samples.end()) {
+		it = model->samples.insert(weak, PerfSourceSample());
+	} else {
+		obs_weak_source_release(weak);
+	}
+	auto &sample = it.value();
+	if (sample.skip > 0 && !sample.pinned && sample.active == source_is_active(source))
+		sample.skip--;
+	else
+		model->refreshSample(source, sample);
+
+	// Left out passes repeat the last sample, quiet sources barely change in between
+	auto h = model->history.find(it.key());
+	if (h == model->history.end()) {
+		obs_weak_source_addref(it.key());
+		h = model->history.insert(it.key(), new PerfHistory());
+	}
+	h.value()->add(model->historyTime, (float)ns_to_ms(total_cost(&sample.exclusive)));
+	return true;
+}
+
+void PerfTreeModel::updateSamples()
+{
+	QMutexLocker locker(&samplesMutex);
+	QMutexLocker historyLocker(&historyMutex);
+	samplePass++;
+	historyTime = (qint64)(os_gettime_ns() / 1000000);
+	obs_enum_all_sources(EnumSample, this);
+
+	for (auto it = samples.begin(); it != samples.end();) {
+		if (obs_weak_source_expired(it.key())) {
+			obs_weak_source_release(it.key());
+			it = samples.erase(it);
+		} else {
+			++it;
+		}
+	}
+	for (auto it = history.begin(); it != history.end();) {
+		if (obs_weak_source_expired(it.key())) {
+			obs_weak_source_release(it.key());
+			delete it.value();
+			it = history.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+PerfSourceSample PerfTreeModel::rowSample(obs_source_t *source, obs_weak_source_t *weak, bool pin)
+{
+	QMutexLocker locker(&samplesMutex);
+	auto it = samples.find(weak);
+	if (it == samples.end()) {
+		obs_weak_source_addref(weak);
+		it = samples.insert(weak, PerfSourceSample());
+	}
+	auto &sample = it.value();
+	sample.pinned = pin;
+	if (!sample.pass || (pin && sample.pass != samplePass))
+		refreshSample(source, sample);
+	return sample;
+}
+
+void PerfTreeModel::forEachSample(const std::function<void(obs_weak_source_t *, const PerfSourceSample &)> &func) const
+{
+	QMutexLocker locker(&samplesMutex);
+	for (auto it = samples.cbegin(); it != samples.cend(); ++it)
+		func(it.key(), it.value());
+}
+
+bool PerfTreeModel::sourceSample(obs_weak_source_t *source, PerfSourceSample &sample) const
+{
+	QMutexLocker locker(&samplesMutex);
+	auto it = samples.constFind(source);
+	if (it == samples.cend())
+		return false;
+	sample = it.value();
+	return true;
+}
+
+qint64 PerfTreeModel::historySeries(obs_weak_source_t *source, qint64 from, qint64 to, int count,
+				    QList<HistoryBucket> &points) const
+{
+	QMutexLocker locker(&historyMutex);
+	auto h = history.value(source);
+	if (!h) {
+		points.clear();
+		return 0;
+	}
+	return h->series(from, to, count, points);
 }
 
 QVariant ColorFormPercentage(double percentage)
@@ -787,33 +2349,89 @@ QVariant ColorFormPercentage(double percentage)
 	return {}; //QColor(91, 98, 115);
 }
 
+/* Colors a change that is worse than the baseline like a share of the frame, 25% worse and up */
+static QVariant regression_color(enum PerfTreeColumnType type, double value, double base, double frameTime)
+{
+	// Rates can move either way for good reasons, so they are not judged
+	if (type == COLUMN_TYPE_FPS)
+		return {};
+	double worse = type == COLUMN_TYPE_SCORE ? base - value : value - base;
+	// Ignore noise, 1% of the frame interval for times and 1 point for percentages
+	double noise = 0.01;
+	if (type == COLUMN_TYPE_DURATION || type == COLUMN_TYPE_INTERVAL)
+		noise = frameTime * 0.01;
+	else if (type == COLUMN_TYPE_PERCENTAGE || type == COLUMN_TYPE_SCORE)
+		noise = 1.0;
+	if (worse <= noise)
+		return {};
+	if (std::abs(base) < 0.005)
+		return ColorFormPercentage(100.0);
+	return ColorFormPercentage(worse / std::abs(base) * 100.0);
+}
+
+void PerfTreeModel::updateCells(PerfTreeItem *item) const
+{
+	uint64_t generation = item->generation;
+	if (item->cells_generation == generation && item->cells_frame_time == frameTime && item->cells_baseline == baselineGeneration &&
+	    item->cells.count() == columns.count())
+		return;
+	item->cells_generation = generation;
+	item->cells_frame_time = frameTime;
+	item->cells_baseline = baselineGeneration;
+	item->cells.resize(columns.count());
+	const BaselineSource *base = baseline ? baseline->find(item->baselineKey()) : nullptr;
+	for (qsizetype i = 0; i < columns.count(); i++) {
+		const auto &column = columns.at(i);
+		auto &cell = item->cells[i];
+		cell.text = column.m_column_type == COLUMN_TYPE_BOOL ? QString() : column.Text(item);
+		cell.background = QVariant();
+		if (baseline && column.Numeric()) {
+			// Rows and columns missing from the baseline stay empty instead of mixing values with changes
+			auto it = base ? base->values.constFind(column.Key()) : QHash<QString, double>::const_iterator();
+			if (!base || it == base->values.constEnd() || !column.HasValue(item)) {
+				cell.text = QString();
+				continue;
+			}
+			double value = column.Number(item);
+			double delta = value - it.value();
+			cell.text = std::abs(delta) < 0.005 ? QString() : QString::asprintf("%+.02f", delta);
+			cell.background = regression_color(column.m_column_type, value, it.value(), frameTime);
+			continue;
+		}
+		if (!column.HasValue(item))
+			continue;
+		if (column.m_column_type == COLUMN_TYPE_PERCENTAGE) {
+			cell.background = ColorFormPercentage(column.Number(item));
+		} else if (column.m_column_type == COLUMN_TYPE_DURATION) {
+			if (frameTime > 0.0)
+				cell.background = ColorFormPercentage(column.Number(item) / frameTime * 100.0);
+		} else if (column.m_column_type == COLUMN_TYPE_SCORE) {
+			cell.background = ColorFormPercentage(100.0 - column.Number(item));
+		} else if (column.m_column_type == COLUMN_TYPE_INTERVAL) {
+			auto interval = column.Number(item);
+			if (frameTime > 0.0 && interval > frameTime)
+				cell.background = ColorFormPercentage((interval - frameTime) / frameTime * 100.0);
+		}
+	}
+}
+
 QVariant PerfTreeModel::data(const QModelIndex &index, int role) const
 {
 	if (!index.isValid())
 		return {};
 	if (role == Qt::CheckStateRole) {
-		auto column = columns.at(index.column());
-		if (column.m_column_type != COLUMN_TYPE_BOOL)
+		const auto &column = columns.at(index.column());
+		if (column.m_column_type != COLUMN_TYPE_BOOL || column.ValueType() != VALUE_TYPE_BOOL)
 			return {};
 		auto item = static_cast<const PerfTreeItem *>(index.internalPointer());
-		auto d = column.Value(item);
-		if (d.userType() == QMetaType::Bool)
-			return d.toBool() ? Qt::Checked : Qt::Unchecked;
+		if (!column.HasValue(item))
+			return {};
+		return column.Number(item) != 0.0 ? Qt::Checked : Qt::Unchecked;
 
 	} else if (role == Qt::DisplayRole) {
-		auto column = columns.at(index.column());
-		if (column.m_column_type == COLUMN_TYPE_BOOL)
-			return {};
 		auto item = static_cast<PerfTreeItem *>(index.internalPointer());
-		auto d = column.Value(item);
-		if (d.userType() == QMetaType::Bool)
-			return {};
-		if (d.userType() == QMetaType::Double) {
-			if (d.toDouble() < 0.005)
-				return {};
-			return QString::asprintf("%.02f", d.toDouble());
-		}
-		return d;
+		updateCells(item);
+		return item->cells.at(index.column()).text;
 
 	} else if (role == Qt::DecorationRole) {
 		if (index.column() != 0)
@@ -822,42 +2440,36 @@ QVariant PerfTreeModel::data(const QModelIndex &index, int role) const
 		auto item = static_cast<PerfTreeItem *>(index.internalPointer());
 		return item->icon;
 	} else if (role == Qt::BackgroundRole) {
-		auto column_type = columns.at(index.column()).m_column_type;
-		if (column_type == COLUMN_TYPE_PERCENTAGE) {
-			auto item = static_cast<PerfTreeItem *>(index.internalPointer());
-			auto column = columns.at(index.column());
-			return ColorFormPercentage(column.Value(item).toDouble());
-
-		} else if (column_type == COLUMN_TYPE_DURATION) {
-			if (frameTime <= 0.0)
-				return {};
-			auto item = static_cast<PerfTreeItem *>(index.internalPointer());
-			auto column = columns.at(index.column());
-			return ColorFormPercentage(column.Value(item).toDouble() / frameTime * 100.0);
-		} else if (column_type == COLUMN_TYPE_INTERVAL) {
-			if (frameTime <= 0.0)
-				return {};
-			auto item = static_cast<PerfTreeItem *>(index.internalPointer());
-			auto column = columns.at(index.column());
-			auto interval = column.Value(item).toDouble();
-			if (interval > frameTime)
-				return ColorFormPercentage((interval - frameTime) / frameTime * 100.0);
-		}
-		return {};
+		auto item = static_cast<PerfTreeItem *>(index.internalPointer());
+		updateCells(item);
+		return item->cells.at(index.column()).background;
 	} else if (role == Qt::TextAlignmentRole) {
 		if (columns.at(index.column()).m_column_type != COLUMN_TYPE_DEFAULT)
 			return Qt::AlignRight;
 	} else if (role == Qt::UserRole) {
 		auto item = static_cast<PerfTreeItem *>(index.internalPointer());
-		auto column = columns.at(index.column());
+		const auto &column = columns.at(index.column());
 		if (column.m_column_type == COLUMN_TYPE_GRAPH) {
 			return item->graph;
 		}
-		auto d = column.Value(item);
-		return d;
+		return column.Value(item);
+	} else if (role == Qt::ToolTipRole) {
+		const auto &column = columns.at(index.column());
+		if (!baseline || !column.Numeric())
+			return {};
+		auto item = static_cast<const PerfTreeItem *>(index.internalPointer());
+		auto base = baseline->find(item->baselineKey());
+		if (!base || !base->values.contains(column.Key()))
+			return QString::fromUtf8(obs_module_text("PerfViewer.BaselineMissing"));
+		return QString::fromUtf8(obs_module_text("PerfViewer.BaselineValue"))
+			.arg(QString::asprintf("%.02f", base->values.value(column.Key())))
+			.arg(baseline->name);
 	} else if (role == Qt::InitialSortOrderRole) {
-		auto column_type = columns.at(index.column()).m_column_type;
-		if (column_type == COLUMN_TYPE_PERCENTAGE || column_type == COLUMN_TYPE_DURATION)
+		const auto &column = columns.at(index.column());
+		// Largest regressions first
+		if (baseline && column.Numeric())
+			return column.m_column_type == COLUMN_TYPE_SCORE ? Qt::AscendingOrder : Qt::DescendingOrder;
+		if (column.m_column_type == COLUMN_TYPE_PERCENTAGE || column.m_column_type == COLUMN_TYPE_DURATION)
 			return Qt::DescendingOrder;
 	}
 
@@ -875,8 +2487,9 @@ Qt::ItemFlags PerfTreeModel::flags(const QModelIndex &index) const
 QVariant PerfTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
 {
 	if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < columns.size()) {
-		auto column = columns.at(section);
-		return column.Name();
+		if (baseline && columns.at(section).Numeric())
+			return QString::fromUtf8(obs_module_text("PerfViewer.DeltaHeader")).arg(columns.at(section).Name());
+		return columns.at(section).Name();
 	}
 
 	return QAbstractItemModel::headerData(section, orientation, role);
@@ -940,7 +2553,7 @@ int PerfTreeModel::columnCount(const QModelIndex &parent) const
 
 void PerfTreeModel::add_filter(obs_source_t *source, obs_source_t *filter, const QModelIndex &parent)
 {
-	if (refreshing)
+	if (refreshing || showMode == ShowMode::HOTSPOTS || showMode == ShowMode::TYPES)
 		return;
 	auto count = rowCount(parent);
 	for (int i = 0; i < count; i++) {
@@ -979,6 +2592,7 @@ void PerfTreeModel::remove_source(obs_source_t *source, const QModelIndex &paren
 			obs_queue_task(OBS_TASK_UI, [](void *d) { delete (PerfTreeItem *)d; }, item, false);
 		} else {
 			remove_source(source, index2);
+			remove_empty_group(index2);
 		}
 	}
 }
@@ -999,10 +2613,23 @@ void PerfTreeModel::remove_weak_source(obs_weak_source_t *source, const QModelIn
 			obs_queue_task(OBS_TASK_UI, [](void *d) { delete (PerfTreeItem *)d; }, item, false);
 		} else {
 			remove_weak_source(source, index2);
+			remove_empty_group(index2);
 		}
 	}
 }
 
+/* Source Type groups go with their last source */
+void PerfTreeModel::remove_empty_group(const QModelIndex &index)
+{
+	auto item = static_cast<PerfTreeItem *>(index.internalPointer());
+	if (!item->is_rollup || !item->m_childItems.isEmpty())
+		return;
+	beginRemoveRows(index.parent(), index.row(), index.row());
+	item->m_parentItem->m_childItems.removeOne(item);
+	endRemoveRows();
+	obs_queue_task(OBS_TASK_UI, [](void *d) { delete (PerfTreeItem *)d; }, item, false);
+}
+
 void PerfTreeModel::remove_siblings(const QModelIndex &parent)
 {
 	auto count = rowCount(parent);
@@ -1027,7 +2654,7 @@ void PerfTreeModel::remove_siblings(const QModelIndex &parent)
 
 void PerfTreeModel::add_sceneitem(obs_source_t *scene, obs_sceneitem_t *sceneitem, const QModelIndex &parent)
 {
-	if (refreshing)
+	if (refreshing || showMode == ShowMode::HOTSPOTS || showMode == ShowMode::TYPES)
 		return;
 	auto count = rowCount(parent);
 	for (int i = 0; i < count; i++) {
@@ -1068,6 +2695,18 @@ void PerfTreeModel::source_add(void *data, calldata_t *cd)
 {
 	obs_source_t *source = (obs_source_t *)calldata_ptr(cd, "source");
 	auto model = (PerfTreeModel *)data;
+	if (model->showMode == ShowMode::HOTSPOTS)
+		return;
+	if (model->showMode == ShowMode::TYPES) {
+		if (source_aggregates_items(source) || (model->activeOnly && !source_is_active(source)))
+			return;
+		auto group = model->typeGroup(source, true);
+		auto pos = group->childCount();
+		model->beginInsertRows(model->createIndex(group->row(), 0, group), pos, pos);
+		group->appendChild(new PerfTreeItem(source, group, model));
+		model->endInsertRows();
+		return;
+	}
 	if ((model->showMode == ShowMode::SCENE || model->showMode == ShowMode::SCENE_NESTED) && !obs_source_is_scene(source))
 		return;
 	if (model->showMode == ShowMode::SCENE_NESTED && ExistsChild(model->rootItem, source))
@@ -1121,11 +2760,98 @@ void PerfTreeModel::source_deactivate(void *data, calldata_t *cd)
 	model->remove_source(source);
 }
 
+/* Most recent markers kept for the Events report */
+#define MAX_MARKERS 500
+
+void PerfTreeModel::addMarker(const char *label, const QString &detail)
+{
+	markers.append({QDateTime::currentMSecsSinceEpoch(), label, detail});
+	while (markers.count() > MAX_MARKERS)
+		markers.removeFirst();
+	pendingMarkers++;
+}
+
+QList<QStringList> PerfTreeModel::markerRows() const
+{
+	QList<QStringList> rows;
+	for (auto i = markers.count() - 1; i >= 0; i--) {
+		const auto &marker = markers.at(i);
+		rows.append(QStringList{QDateTime::fromMSecsSinceEpoch(marker.time).toString("HH:mm:ss.zzz"),
+					QString::fromUtf8(obs_module_text(marker.label)), marker.detail});
+	}
+	return rows;
+}
+
+static QString current_scene_name()
+{
+	obs_source_t *scene = obs_frontend_get_current_scene();
+	QString name = QString::fromUtf8(obs_source_get_name(scene));
+	obs_source_release(scene);
+	return name;
+}
+
+static QString current_transition_name()
+{
+	obs_source_t *transition = obs_frontend_get_current_transition();
+	QString name = QString::fromUtf8(obs_source_get_name(transition));
+	obs_source_release(transition);
+	return name;
+}
+
+static QString current_name(char *name)
+{
+	QString result = QString::fromUtf8(name);
+	bfree(name);
+	return result;
+}
+
+void PerfTreeModel::recordMarker(enum obs_frontend_event event)
+{
+	switch (event) {
+	case OBS_FRONTEND_EVENT_SCENE_CHANGED:
+		addMarker("PerfViewer.EventSceneChanged", current_scene_name());
+		break;
+	case OBS_FRONTEND_EVENT_TRANSITION_STOPPED:
+		addMarker("PerfViewer.EventTransitionStopped", current_transition_name());
+		break;
+	case OBS_FRONTEND_EVENT_TRANSITION_CHANGED:
+		addMarker("PerfViewer.EventTransitionChanged", current_transition_name());
+		break;
+	case OBS_FRONTEND_EVENT_STREAMING_STARTED:
+		addMarker("PerfViewer.EventStreamingStarted");
+		break;
+	case OBS_FRONTEND_EVENT_STREAMING_STOPPED:
+		addMarker("PerfViewer.EventStreamingStopped");
+		break;
+	case OBS_FRONTEND_EVENT_RECORDING_STARTED:
+		addMarker("PerfViewer.EventRecordingStarted");
+		break;
+	case OBS_FRONTEND_EVENT_RECORDING_STOPPED:
+		addMarker("PerfViewer.EventRecordingStopped");
+		break;
+	case OBS_FRONTEND_EVENT_REPLAY_BUFFER_SAVED:
+		addMarker("PerfViewer.EventReplayBufferSaved");
+		break;
+	case OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED:
+		addMarker("PerfViewer.EventSceneCollectionChanged", current_name(obs_frontend_get_current_scene_collection()));
+		break;
+	case OBS_FRONTEND_EVENT_PROFILE_CHANGED:
+		addMarker("PerfViewer.EventProfileChanged", current_name(obs_frontend_get_current_profile()));
+		break;
+	default:
+		break;
+	}
+}
+
 void PerfTreeModel::frontend_event(obs_frontend_event event, void *data)
 {
+	static_cast<PerfTreeModel *>(data)->recordMarker(event);
 	if (event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CLEANUP || event == OBS_FRONTEND_EVENT_EXIT ||
 	    event == OBS_FRONTEND_EVENT_SCRIPTING_SHUTDOWN || event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGING) {
 		auto model = (PerfTreeModel *)data;
+		// Baselines belong to the collection they were captured in
+		if (event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGING && model->baseline)
+			model->setBaseline(nullptr);
 		model->refreshing = true;
 		model->beginResetModel();
 		model->remove_siblings();
@@ -1174,26 +2900,15 @@ PerfTreeItem::PerfTreeItem(obs_source_t *source, PerfTreeItem *parent, PerfTreeM
 	graph = QImage(1, 24, QImage::Format_RGB32);
 	graph.fill(0);
 	name = QString::fromUtf8(source ? obs_source_get_name(source) : "");
+	uuid = QString::fromUtf8(source ? obs_source_get_uuid(source) : "");
+	if (model && !uuid.isEmpty()) {
+		QMutexLocker locker(&model->pinnedMutex);
+		pinned = model->pinned.contains(uuid);
+	}
+	for (auto parent = m_parentItem; pinned && parent; parent = parent->m_parentItem)
+		parent->pinned_below = true;
 	sourceDisplayName = QString::fromUtf8(source ? obs_source_get_display_name(obs_source_get_unversioned_id(source)) : "");
-	if (source)
-		switch (obs_source_get_type(source)) {
-		case OBS_SOURCE_TYPE_INPUT:
-			sourceType = QString::fromUtf8(obs_frontend_get_locale_string("Basic.Main.Source"));
-			break;
-		case OBS_SOURCE_TYPE_FILTER:
-			sourceType = QString::fromUtf8(obs_frontend_get_locale_string("Basic.Filters"));
-			break;
-		case OBS_SOURCE_TYPE_TRANSITION:
-			sourceType = QString::fromUtf8(obs_frontend_get_locale_string("Transition"));
-			break;
-		case OBS_SOURCE_TYPE_SCENE:
-			if (obs_source_is_group(source)) {
-				sourceType = QString::fromUtf8(obs_frontend_get_locale_string("Group"));
-			} else {
-				sourceType = QString::fromUtf8(obs_frontend_get_locale_string("Basic.Scene"));
-			}
-			break;
-		}
+	sourceType = source_type_name(source);
 
 	is_filter = source && (obs_source_get_type(source) == OBS_SOURCE_TYPE_FILTER);
 	if (is_filter)
@@ -1212,6 +2927,14 @@ PerfTreeItem::PerfTreeItem(obs_source_t *source, PerfTreeItem *parent, PerfTreeM
 	async = (!is_filter && source &&
 		 ((obs_source_get_output_flags(source) & OBS_SOURCE_ASYNC_VIDEO) == OBS_SOURCE_ASYNC_VIDEO));
 	is_private = source && obs_obj_is_private(source);
+	searchName = name.toCaseFolded();
+	if (source)
+		searchType = (sourceDisplayName + " " + QString::fromUtf8(obs_source_get_unversioned_id(source)) + " " + sourceType)
+				     .toCaseFolded();
+	if (parent)
+		searchScene = parent->searchScene;
+	if (source && obs_source_is_scene(source))
+		searchScene += "\n" + searchName;
 	icon = getIcon(source);
 	m_perf = new profiler_result_t;
 	memset(m_perf, 0, sizeof(profiler_result_t));
@@ -1294,42 +3017,149 @@ PerfTreeItem *PerfTreeItem::parentItem()
 	return m_parentItem;
 }
 
+/* Share of the frame interval and its graph color */
+static QRgb graph_color(double val)
+{
+	if (val >= 1.0)
+		return 0xE85E75;
+	if (val >= 0.5)
+		return 0xEABC48;
+	if (val >= 0.25)
+		return 0x718CDC;
+	return 0x5B6273;
+}
+
+const QString &PerfTreeItem::baselineKey() const
+{
+	if (!baseline_key.isEmpty())
+		return baseline_key;
+	if (is_rollup) {
+		baseline_key = QString::fromUtf8("type:") + rollupId;
+	} else if (is_pipeline) {
+		baseline_key = QString::fromUtf8("pipeline:") + pipelinePath;
+	} else if (!uuid.isEmpty()) {
+		// A source shown in several places gets a key per placement, its cost differs between them
+		QString key = uuid;
+		if (m_sceneitem)
+			key += QString::fromUtf8("#") + QString::number(obs_sceneitem_get_id(m_sceneitem));
+		QString parent = m_parentItem ? m_parentItem->baselineKey() : QString();
+		baseline_key = parent.isEmpty() ? key : parent + QString::fromUtf8("/") + key;
+	}
+	return baseline_key;
+}
+
+void PerfTreeItem::expressionInput(ExpressionInput &input) const
+{
+	input.setResult(m_perf);
+	input.setSize(width, height);
+	input.setCanvas();
+	input.values[EXPRESSION_RENDERS] = renders_per_frame;
+	input.values[EXPRESSION_SHARE] = share;
+	input.values[EXPRESSION_CHILDREN] = (double)child_count;
+	input.values[EXPRESSION_ACTIVE] = active;
+	input.values[EXPRESSION_RENDERED] = rendered;
+	input.values[EXPRESSION_ENABLED] = enabled;
+	input.values[EXPRESSION_ASYNC] = async;
+	input.values[EXPRESSION_FILTER] = is_filter;
+}
+
+bool PerfTreeItem::updateExpressions()
+{
+	const auto &set = m_model->passExpressions;
+	if (!set || set->isEmpty()) {
+		if (!expression_values)
+			return false;
+		std::atomic_store(&expression_values, std::shared_ptr<PerfExpressionValues>());
+		return true;
+	}
+	bool changed = false;
+	if (!expression_values || expression_values->expressions != set) {
+		auto values = std::make_shared<PerfExpressionValues>();
+		values->expressions = set;
+		values->values.resize(set->count());
+		std::atomic_store(&expression_values, values);
+		changed = true;
+	}
+	ExpressionInput input;
+	expressionInput(input);
+	auto &values = expression_values->values;
+	for (qsizetype i = 0; i < set->count(); i++) {
+		double value = set->at(i)->evaluate(input);
+		if (value == values[i])
+			continue;
+		values[i] = value;
+		changed = true;
+	}
+	return changed;
+}
+
+bool PerfTreeItem::visible() const
+{
+	for (auto parent = m_parentItem; parent && parent->m_parentItem; parent = parent->m_parentItem) {
+		if (!parent->expanded)
+			return false;
+	}
+	return true;
+}
+
+/* Rows left out keep the values of their last update, also for their parents' totals */
+bool PerfTreeItem::sampleDue()
+{
+	// Groups and core stages only add up their children, destroyed sources are cleared by update.
+	// A skipped row skips its subtree, so rows above a pinned row are updated with it.
+	if (!m_source || !sampled || pinned || pinned_below)
+		return true;
+	PerfSourceSample sample;
+	if (!m_model->sourceSample(m_source, sample))
+		return true;
+	if (!sample.active && (m_model->activeOnly || !visible())) {
+		// Not updated at all, and updated right away once it is shown again
+		hidden = true;
+		return false;
+	}
+	if (hidden) {
+		hidden = false;
+		return true;
+	}
+	// Quiet sources back off in PerfTreeModel::refreshSample, their rows follow
+	return sample.pass == m_model->samplePass;
+}
+
 void PerfTreeItem::update()
 {
+	if (!sampleDue()) {
+		skipped_passes++;
+		return;
+	}
+
 	profiler_result_t old;
 	memcpy(&old, m_perf, sizeof(profiler_result_t));
 	bool old_active = active;
 	bool old_rendered = rendered;
 	bool old_enabled = enabled;
+	uint32_t old_width = width;
+	uint32_t old_height = height;
 	obs_source_t *source = obs_weak_source_get_source(m_source);
 	bool cleared = false;
 	if (source) {
-		source_profiler_fill_result(source, m_perf);
+		auto sample = m_model->rowSample(source, m_source, pinned);
+		memcpy(m_perf, &sample.exclusive, sizeof(profiler_result_t));
+		sampled = true;
+
+		// Both from the source's own result, before filters are subtracted and children added
+		const auto &own = sample.perf;
+		renders_per_frame = own.render_avg ? (double)own.render_sum / (double)own.render_avg : 0.0;
+		redundant_render = redundant_render_cost(&own);
 
 		if (obs_source_get_type(source) == OBS_SOURCE_TYPE_FILTER) {
-			rendered = m_parentItem->rendered && obs_source_enabled(source);
-			active = m_parentItem->active && obs_source_enabled(source);
-			if ((obs_source_get_output_flags(source) & OBS_SOURCE_ASYNC_VIDEO) != OBS_SOURCE_ASYNC_VIDEO) {
-				obs_source_t *target = obs_filter_get_target(source);
-				while (target && !obs_source_enabled(target)) {
-					target = obs_filter_get_target(target);
-				}
-				if (target) {
-					profiler_result_t diff;
-					source_profiler_fill_result(target, &diff);
-					if (m_perf->render_avg >= diff.render_avg)
-						m_perf->render_avg -= diff.render_avg;
-					if (m_perf->render_max >= diff.render_max)
-						m_perf->render_max -= diff.render_max;
-					if (m_perf->render_gpu_avg >= diff.render_gpu_avg)
-						m_perf->render_gpu_avg -= diff.render_gpu_avg;
-					if (m_perf->render_gpu_max >= diff.render_gpu_max)
-						m_perf->render_gpu_max -= diff.render_gpu_max;
-					if (m_perf->render_sum >= diff.render_sum)
-						m_perf->render_sum -= diff.render_sum;
-					if (m_perf->render_gpu_sum >= diff.render_gpu_sum)
-						m_perf->render_gpu_sum -= diff.render_gpu_sum;
-				}
+			if (m_parentItem->m_source) {
+				rendered = m_parentItem->rendered && obs_source_enabled(source);
+				active = m_parentItem->active && obs_source_enabled(source);
+			} else {
+				// Flat lists have no parent row to inherit from
+				obs_source_t *parent = obs_filter_get_parent(source);
+				rendered = parent && obs_source_showing(parent) && obs_source_enabled(source);
+				active = parent && obs_source_active(parent) && obs_source_enabled(source);
 			}
 		} else {
 			rendered = obs_source_showing(source);
@@ -1337,6 +3167,8 @@ void PerfTreeItem::update()
 		}
 
 		enabled = m_sceneitem ? obs_sceneitem_visible(m_sceneitem) : obs_source_enabled(source);
+		width = obs_source_get_width(source);
+		height = obs_source_get_height(source);
 
 		obs_source_release(source);
 	} else if (m_source) {
@@ -1349,14 +3181,30 @@ void PerfTreeItem::update()
 		obs_weak_source_release(m_source);
 		m_source = nullptr;
 		cleared = true;
+	} else if (is_pipeline) {
+		// Core stages are CPU time on libobs threads, so they show as CPU render
+		memset(m_perf, 0, sizeof(profiler_result_t));
+		auto stage = m_model->pipelineStages.value(pipelinePath);
+		m_perf->render_avg = stage.avg;
+		m_perf->render_max = stage.max;
+		m_perf->render_sum = stage.sum;
+		p50 = stage.p50;
+		p95 = stage.p95;
+		p99 = stage.p99;
+	} else {
+		// Items without a source only aggregate their children
+		memset(m_perf, 0, sizeof(profiler_result_t));
 	}
 
 	if (!m_childItems.empty()) {
 		for (auto item : m_childItems) {
 			item->update();
-			m_perf->tick_avg += item->m_perf->tick_avg;
-			m_perf->tick_max += item->m_perf->tick_max;
-			if (item->is_filter) {
+			// Nested stages are already part of their parent stage
+			if (is_pipeline)
+				continue;
+			m_perf->tick_avg += (uint64_t)((double)item->m_perf->tick_avg * item->share);
+			m_perf->tick_max += (uint64_t)((double)item->m_perf->tick_max * item->share);
+			if (item->is_filter || is_rollup) {
 				m_perf->render_avg += item->m_perf->render_avg;
 				m_perf->render_max += item->m_perf->render_max;
 				m_perf->render_gpu_avg += item->m_perf->render_gpu_avg;
@@ -1373,24 +3221,39 @@ void PerfTreeItem::update()
 		}
 	}
 
-	auto width = m_model->graphWidthFunc();
-	if (width > 0) {
-		auto val = (double)(m_perf->tick_avg + m_perf->render_sum + m_perf->render_gpu_sum) /
-			   (double)obs_get_frame_interval_ns();
-		auto color = 0x5B6273;
-		if (val >= 1.0)
-			color = 0xE85E75;
-		else if (val >= 0.5)
-			color = 0xEABC48;
-		else if (val >= 0.25)
-			color = 0x718CDC;
+	if (async)
+		updateAsyncHealth();
+	updateSearchIndex();
+	bool expressions_changed = updateExpressions();
+
+	auto graph_width = m_model->graphWidthFunc();
+	if (graph_width > 0 && m_model->graphSpan > 0) {
+		drawHistory(graph_width);
+	} else if (graph_width > 0) {
+		auto val = (double)total_cost(m_perf) / (double)obs_get_frame_interval_ns();
+		auto color = graph_color(val);
 		if (val > 1.0)
 			val = 1.0;
 		int h = graph.height() * (1.0 - val);
+		if (history_graph) {
+			// Scrolling starts over instead of continuing from the history
+			graph = QImage(1, graph.height(), QImage::Format_RGB32);
+			graph.fill(0);
+			history_graph = false;
+		}
 		if (graph.width() <= 1) {
 			prev_graph_value = h;
 		}
-		graph = graph.copy(graph.width() - width + 1, 0, width, graph.height());
+		// Passes the scheduler left out are filled in gray at the previous value
+		int shift = std::min(skipped_passes + 1, graph_width);
+		graph = graph.copy(graph.width() - graph_width + shift, 0, graph_width, graph.height());
+		for (int x = graph.width() - shift; x < graph.width() - 1; x++)
+			graph.setPixel(x, prev_graph_value, 0x5B6273);
+		if (m_model->markerPass) {
+			// Dotted line where a frontend event happened since the previous pass
+			for (int i = 0; i < graph.height(); i += 2)
+				graph.setPixel(graph.width() - 1, i, 0xB8BCC8);
+		}
 		if (h < prev_graph_value) {
 			for (int i = h; i <= prev_graph_value; i++) {
 				graph.setPixel(graph.width() - 1, i, color);
@@ -1405,15 +3268,130 @@ void PerfTreeItem::update()
 		graph = graph.copy(graph.width(), 0, 1, graph.height());
 		graph.fill(0);
 	}
+	skipped_passes = 0;
 
-	if (m_model && (m_source || cleared)) {
-		if (cleared || old_active != active || old_rendered != rendered || old_enabled != enabled ||
-		    memcmp(&old, m_perf, sizeof(profiler_result_t)) != 0) {
+	if (m_model && (m_source || cleared || is_rollup || is_pipeline)) {
+		if (cleared || expressions_changed || old_active != active || old_rendered != rendered || old_enabled != enabled ||
+		    old_width != width || old_height != height || memcmp(&old, m_perf, sizeof(profiler_result_t)) != 0) {
+			generation++;
 			m_model->itemChanged(this);
 		}
 	}
 }
 
+void PerfTreeItem::drawHistory(int width)
+{
+	if (graph.width() != width)
+		graph = QImage(width, graph.height(), QImage::Format_RGB32);
+	graph.fill(0);
+	history_graph = true;
+	// Items without a source of their own, like type groups and core stages, have no history
+	auto h = m_source ? m_model->history.value(m_source) : nullptr;
+	double frame = m_model->frameTime;
+	if (!h || frame <= 0.0)
+		return;
+	QList<HistoryBucket> points;
+	h->series(m_model->historyTime - m_model->graphSpan, m_model->historyTime, width, points);
+	int bottom = graph.height() - 1;
+	auto row = [&](float v) { return bottom - (int)(std::min((double)v / frame, 1.0) * bottom); };
+	for (int x = 0; x < points.count(); x++) {
+		const auto &p = points.at(x);
+		if (p.empty())
+			continue;
+		// Range between min and max in the tick color with the average on top
+		for (int y = row(p.max); y <= row(p.min); y++)
+			graph.setPixel(x, y, 0x5B6273);
+		graph.setPixel(x, row(p.avg), graph_color((double)p.avg / frame));
+	}
+}
+
+/* Passes below 90% of the expected input rate in a row that count as one under-delivery */
+#define ASYNC_UNDERRUN_PASSES 3
+/* Part of the peak input rate kept per pass, so a lower rate after a format change becomes the expectation */
+#define ASYNC_PEAK_DECAY 0.98
+
+void PerfTreeItem::updateAsyncHealth()
+{
+	uint64_t interval = obs_get_frame_interval_ns();
+	double canvas_fps = interval ? 1000000000.0 / (double)interval : 0.0;
+	double input = m_perf->async_input;
+
+	// Frames decoded but never shown, a 60 fps camera in a 30 fps canvas wastes half
+	async_dropped = input > m_perf->async_rendered ? input - m_perf->async_rendered : 0.0;
+	async_wasteful = canvas_fps > 0.0 && input > canvas_fps * 1.1 && async_dropped > 0.0;
+
+	// Spread between the shortest and longest input interval against the frame interval
+	async_jitter = interval && m_perf->async_input_worst > m_perf->async_input_best
+			       ? (double)(m_perf->async_input_worst - m_perf->async_input_best) / (double)interval * 100.0
+			       : 0.0;
+
+	// Expect the best rate the source reached recently, up to the canvas rate. The peak decays over the passes
+	// and starts over when the source is deactivated.
+	if (active)
+		async_peak_input = std::max(async_peak_input * std::pow(ASYNC_PEAK_DECAY, skipped_passes + 1), input);
+	else
+		async_peak_input = 0.0;
+	double expected = std::min(async_peak_input, canvas_fps);
+	bool under = active && expected > 0.0 && input < expected * 0.9;
+	// Passes the row was left out of count when it was under-delivering before and after them
+	int passes = async_underrun_streak ? skipped_passes + 1 : 1;
+	int streak = under ? async_underrun_streak + passes : 0;
+	if (streak >= ASYNC_UNDERRUN_PASSES && async_underrun_streak < ASYNC_UNDERRUN_PASSES)
+		async_underruns++;
+	async_underrun_streak = streak;
+
+	double waste = input > 0.0 ? async_dropped / input : 0.0;
+	double health = 100.0;
+	health -= 30.0 * std::min(waste, 1.0);
+	health -= 30.0 * std::min(async_jitter / 100.0, 1.0);
+	if (async_underrun_streak >= ASYNC_UNDERRUN_PASSES)
+		health -= 40.0;
+	async_health = std::max(health, 0.0);
+}
+
+uint32_t PerfTreeItem::searchFlags() const
+{
+	return (async ? 1u << (SEARCH_ASYNC - SEARCH_NUMERIC_COUNT) : 0) |
+	       (active ? 1u << (SEARCH_ACTIVE - SEARCH_NUMERIC_COUNT) : 0) |
+	       (rendered ? 1u << (SEARCH_RENDERED - SEARCH_NUMERIC_COUNT) : 0) |
+	       (enabled ? 1u << (SEARCH_ENABLED - SEARCH_NUMERIC_COUNT) : 0) |
+	       (is_private ? 1u << (SEARCH_PRIVATE - SEARCH_NUMERIC_COUNT) : 0) |
+	       (is_filter ? 1u << (SEARCH_FILTER - SEARCH_NUMERIC_COUNT) : 0) |
+	       (async_wasteful ? 1u << (SEARCH_WASTEFUL - SEARCH_NUMERIC_COUNT) : 0);
+}
+
+void PerfTreeItem::updateSearchIndex()
+{
+	auto &index = search_index;
+	index.metrics[SEARCH_CPU] = frame_percentage(m_perf->render_sum + m_perf->tick_avg);
+	index.metrics[SEARCH_GPU] = frame_percentage(m_perf->render_gpu_sum);
+	index.metrics[SEARCH_TOTAL] = frame_percentage(total_cost(m_perf));
+	index.metrics[SEARCH_TICK] = ns_to_ms(m_perf->tick_avg);
+	index.metrics[SEARCH_TICK_MAX] = ns_to_ms(m_perf->tick_max);
+	index.metrics[SEARCH_RENDER] = ns_to_ms(m_perf->render_sum);
+	index.metrics[SEARCH_FPS] = async ? m_perf->async_input : 0.0;
+	index.metrics[SEARCH_WIDTH] = (double)width;
+	index.metrics[SEARCH_HEIGHT] = (double)height;
+
+	uint32_t all = (1u << (SEARCH_NAME - SEARCH_NUMERIC_COUNT)) - 1;
+	index.flags = searchFlags();
+	index.subtree_true = index.flags;
+	index.subtree_false = ~index.flags & all;
+	for (int i = 0; i < SEARCH_NUMERIC_COUNT; i++) {
+		index.subtree_min[i] = index.metrics[i];
+		index.subtree_max[i] = index.metrics[i];
+	}
+	for (auto item : m_childItems) {
+		const auto &child = item->search_index;
+		index.subtree_true |= child.subtree_true;
+		index.subtree_false |= child.subtree_false;
+		for (int i = 0; i < SEARCH_NUMERIC_COUNT; i++) {
+			index.subtree_min[i] = std::min(index.subtree_min[i], child.subtree_min[i]);
+			index.subtree_max[i] = std::max(index.subtree_max[i], child.subtree_max[i]);
+		}
+	}
+}
+
 QIcon PerfTreeItem::getIcon(obs_source_t *source) const
 {
 	// ToDo icons for root?
@@ -1,13 +1,34 @@
 
 #include "obs-module.h"
+#include "perf-expression.hpp"
+#include "perf-baseline.hpp"
 #include <QDialog>
 #include <QThread>
 #include <QTreeView>
 #include <QSortFilterProxyModel>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <atomic>
 #include <util/source-profiler.h>
+#include <util/profiler.h>
 #include <obs-frontend-api.h>
 
 class PerfTreeItem;
+class PerfExperimentRunner;
+class PerfBudgetWidget;
+class PerfLagTracker;
+class PerfAdvisor;
+class PerfRegressionTracker;
+class PerfTransitionTracker;
+class PerfActivationTracker;
+class PerfLoadProfiler;
+class PerfHistory;
+struct HistoryBucket;
+class QComboBox;
+class QMenu;
 
 enum PerfTreeColumnType {
 	COLUMN_TYPE_DEFAULT,
@@ -17,20 +38,69 @@ enum PerfTreeColumnType {
 	COLUMN_TYPE_PERCENTAGE,
 	COLUMN_TYPE_FPS,
 	COLUMN_TYPE_COUNT,
+	COLUMN_TYPE_RATIO,
+	/* 0 to 100, higher is better */
+	COLUMN_TYPE_SCORE,
 	COLUMN_TYPE_GRAPH,
 };
 
+enum PerfTreeValueType {
+	VALUE_TYPE_TEXT,
+	VALUE_TYPE_BOOL,
+	VALUE_TYPE_DOUBLE,
+	/* Durations are stored as ns and shown as ms */
+	VALUE_TYPE_NS,
+	VALUE_TYPE_UINT,
+	VALUE_TYPE_NONE,
+	/* User defined, evaluated from PerfTreeItem::expressionInput */
+	VALUE_TYPE_EXPRESSION,
+};
+
 class PerfTreeColumn {
-	QVariant (*m_get_value)(const PerfTreeItem *item);
-	QString m_name;
+	const char *m_name;
+	enum PerfTreeValueType m_value_type;
+	union {
+		const QString &(*text)(const PerfTreeItem *item);
+		bool (*boolean)(const PerfTreeItem *item);
+		double (*number)(const PerfTreeItem *item);
+		uint64_t (*uint)(const PerfTreeItem *item);
+	} m_get;
+	bool (*m_has_value)(const PerfTreeItem *item);
 	bool m_default_hidden;
+	std::shared_ptr<const PerfExpression> m_expression;
+	int m_expression_index = -1;
+	QString m_title;
 
 public:
-	PerfTreeColumn(QString name, QVariant (*getValue)(const PerfTreeItem *item),
+	PerfTreeColumn(const char *name, const QString &(*getText)(const PerfTreeItem *item),
 		       enum PerfTreeColumnType column_type = COLUMN_TYPE_DEFAULT, bool default_hidden = false);
-	QString Name() { return m_name; }
-	QVariant Value(const PerfTreeItem *item) { return m_get_value(item); }
-	bool DefaultHidden() { return m_default_hidden; }
+	PerfTreeColumn(const char *name, bool (*getBool)(const PerfTreeItem *item), enum PerfTreeColumnType column_type = COLUMN_TYPE_BOOL,
+		       bool default_hidden = false, bool (*hasValue)(const PerfTreeItem *item) = nullptr);
+	PerfTreeColumn(const char *name, double (*getDouble)(const PerfTreeItem *item), enum PerfTreeColumnType column_type,
+		       bool default_hidden = false, bool (*hasValue)(const PerfTreeItem *item) = nullptr);
+	PerfTreeColumn(const char *name, uint64_t (*getUint)(const PerfTreeItem *item), enum PerfTreeColumnType column_type,
+		       bool default_hidden = false, bool (*hasValue)(const PerfTreeItem *item) = nullptr);
+	PerfTreeColumn(const char *name, enum PerfTreeColumnType column_type);
+	/* index is the column's position among the expression columns */
+	PerfTreeColumn(const ExpressionColumn &column, int index);
+
+	QString Name() const { return m_name ? QString::fromUtf8(obs_module_text(m_name)) : m_title; }
+	/* Untranslated identity, used to match saved values */
+	QString Key() const { return m_name ? QString::fromUtf8(m_name) : QString::fromUtf8("expression.") + m_title; }
+	bool DefaultHidden() const { return m_default_hidden; }
+	enum PerfTreeValueType ValueType() const { return m_value_type; }
+	bool Numeric() const
+	{
+		return m_value_type == VALUE_TYPE_DOUBLE || m_value_type == VALUE_TYPE_NS || m_value_type == VALUE_TYPE_UINT ||
+		       m_value_type == VALUE_TYPE_EXPRESSION;
+	}
+	bool HasValue(const PerfTreeItem *item) const;
+	/* Numeric value in display units, durations in ms */
+	double Number(const PerfTreeItem *item) const;
+	QString Text(const PerfTreeItem *item) const;
+	QVariant Value(const PerfTreeItem *item) const;
+	/* Compares the raw values, returns <0, 0 or >0 */
+	int Compare(const PerfTreeItem *left, const PerfTreeItem *right) const;
 
 private:
 	enum PerfTreeColumnType m_column_type;
@@ -38,6 +108,108 @@ private:
 	friend class PerfTreeModel;
 };
 
+typedef QList<std::shared_ptr<const PerfExpression>> PerfExpressionSet;
+
+/* Expression column values of the last pass, with the expressions they were evaluated from.
+   Allocated when the expression columns change and overwritten in place on every pass. */
+struct PerfExpressionValues {
+	std::shared_ptr<const PerfExpressionSet> expressions;
+	QList<double> values;
+};
+
+/* One source's profiler result, refreshed once per pass at most, quiet sources back off */
+struct PerfSourceSample {
+	/* As reported by the profiler */
+	profiler_result_t perf = {};
+	/* Filters without their render target, the same as perf for everything else */
+	profiler_result_t exclusive = {};
+	enum obs_source_type kind = OBS_SOURCE_TYPE_INPUT;
+	bool active = false;
+	/* A pinned row shows the source, it is refreshed on every pass */
+	bool pinned = false;
+	/* Pass of the last refresh, 0 before the first */
+	uint64_t pass = 0;
+	int interval = 1;
+	int skip = 0;
+};
+
+struct PerfTreeCell {
+	QString text;
+	QVariant background;
+};
+
+enum PerfSearchField {
+	/* Numeric metrics, kept per item and as subtree min/max */
+	SEARCH_CPU,
+	SEARCH_GPU,
+	SEARCH_TOTAL,
+	SEARCH_TICK,
+	SEARCH_TICK_MAX,
+	SEARCH_RENDER,
+	SEARCH_FPS,
+	SEARCH_WIDTH,
+	SEARCH_HEIGHT,
+	SEARCH_NUMERIC_COUNT,
+	/* Flags, kept per item and as subtree any-true/any-false masks */
+	SEARCH_ASYNC = SEARCH_NUMERIC_COUNT,
+	SEARCH_ACTIVE,
+	SEARCH_RENDERED,
+	SEARCH_ENABLED,
+	SEARCH_PRIVATE,
+	SEARCH_FILTER,
+	SEARCH_WASTEFUL,
+	/* Pre-normalized text */
+	SEARCH_NAME,
+	SEARCH_TYPE,
+	SEARCH_SCENE,
+};
+
+enum PerfSearchOp {
+	SEARCH_OP_CONTAINS,
+	SEARCH_OP_EQ,
+	SEARCH_OP_NE,
+	SEARCH_OP_GT,
+	SEARCH_OP_GE,
+	SEARCH_OP_LT,
+	SEARCH_OP_LE,
+};
+
+/* Numeric and flag part of a row's search index, with the summaries of its subtree */
+struct PerfSearchIndex {
+	double metrics[SEARCH_NUMERIC_COUNT] = {};
+	double subtree_min[SEARCH_NUMERIC_COUNT] = {};
+	double subtree_max[SEARCH_NUMERIC_COUNT] = {};
+	uint32_t flags = 0;
+	uint32_t subtree_true = 0;
+	uint32_t subtree_false = 0;
+};
+
+struct PerfSearchTerm {
+	enum PerfSearchField field;
+	enum PerfSearchOp op;
+	double value;
+	QString text;
+};
+
+/* Parsed search query, e.g. "camera type:browser cpu>5 async:true". Plain words and text fields match as
+   case-insensitive substrings, not as regular expressions. */
+class PerfSearch {
+	QList<PerfSearchTerm> terms;
+	bool dynamic = false;
+
+public:
+	void parse(const QString &filter);
+	bool isEmpty() const { return terms.isEmpty(); }
+	/* Whether the result depends on values that change every update */
+	bool isDynamic() const { return dynamic; }
+	bool matches(const PerfTreeItem *item) const;
+	/* False when the subtree summaries prove nothing below item can match */
+	bool subtreeMayMatch(const PerfTreeItem *item) const;
+};
+
+/* Cell background for a share of the frame, invalid below 25% */
+QVariant ColorFormPercentage(double percentage);
+
 class PerfTreeModel;
 class PerfViewerProxyModel;
 
@@ -48,9 +220,31 @@ class OBSPerfViewer : public QDialog {
 	PerfViewerProxyModel *proxy = nullptr;
 
 	QTreeView *treeView = nullptr;
+	QComboBox *rankingBox = nullptr;
+	QComboBox *graphSpanBox = nullptr;
+	QMenu *baselineMenu = nullptr;
+	PerfExperimentRunner *experiments = nullptr;
+	PerfBudgetWidget *budget = nullptr;
+	PerfLagTracker *lagTracker = nullptr;
+	PerfAdvisor *advisor = nullptr;
+	PerfRegressionTracker *regressionTracker = nullptr;
+	PerfTransitionTracker *transitionTracker = nullptr;
+	PerfActivationTracker *activationTracker = nullptr;
+	PerfLoadProfiler *loadProfiler = nullptr;
+	QPointer<QDialog> experimentsReport;
+	QPointer<QDialog> regressionsReport;
+	QList<ExpressionColumn> expressions;
 
 	bool loaded = false;
 
+	void setExpressions(const QList<ExpressionColumn> &columns);
+	void showExperiments();
+	void showCollectionLoad();
+	void showRegressions();
+	void updateBaselineMenu();
+	/* Hands the expanded state of the view's rows to the scheduler, the view emits nothing for expandAll */
+	void syncExpanded(const QModelIndex &parent = QModelIndex());
+
 public:
 	OBSPerfViewer(QWidget *parent = nullptr);
 	~OBSPerfViewer() override;
@@ -76,14 +270,19 @@ public:
 	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
 	int columnCount(const QModelIndex &parent = QModelIndex()) const override;
 	enum PerfTreeColumnType columnType(int column) const { return columns.at(column).m_column_type; }
+	const PerfTreeColumn &column(int column) const { return columns.at(column); }
 
 	void itemChanged(PerfTreeItem *item);
 
-	enum ShowMode { SCENE, SCENE_NESTED, SOURCE, FILTER, TRANSITION, ALL };
+	enum ShowMode { SCENE, SCENE_NESTED, SOURCE, FILTER, TRANSITION, ALL, HOTSPOTS, TYPES };
+	enum HotspotMetric { HOTSPOT_TOTAL, HOTSPOT_CPU, HOTSPOT_GPU, HOTSPOT_TICK_MAX, HOTSPOT_RENDER_MAX };
+	/* How the tick cost of a source referenced from several parents is added to those parents */
+	enum SharedAttribution { SHARED_FULL, SHARED_EVEN, SHARED_RENDER_WEIGHTED };
 
 	void setShowMode(enum ShowMode s = ShowMode::SCENE)
 	{
 		showMode = s;
+		dropMismatchedBaseline();
 		refreshSources();
 	}
 	enum ShowMode getShowMode() { return showMode; }
@@ -97,11 +296,71 @@ public:
 
 	void setRefreshInterval(int interval);
 
+	void setSharedAttribution(enum SharedAttribution a)
+	{
+		sharedAttribution = a;
+		dropMismatchedBaseline();
+	}
+	enum SharedAttribution getSharedAttribution() const { return sharedAttribution; }
+
+	void setHotspotMetric(enum HotspotMetric metric) { hotspotMetric = metric; }
+	enum HotspotMetric getHotspotMetric() const { return hotspotMetric; }
+	void setHotspotCount(int count) { hotspotCount = count; }
+	int getHotspotCount() const { return hotspotCount; }
+
+	void setShowPipeline(bool p, bool refresh = true)
+	{
+		showPipeline = p;
+		if (refresh)
+			refreshSources();
+	}
+	bool getShowPipeline() const { return showPipeline; }
+
+	/* Time span of the graph column in ms, 0 scrolls one pixel per update */
+	void setGraphSpan(qint64 span) { graphSpan = span; }
+	qint64 getGraphSpan() const { return graphSpan; }
+	/* Calls func with the latest sample of every source, from any thread */
+	void forEachSample(const std::function<void(obs_weak_source_t *, const PerfSourceSample &)> &func) const;
+	/* Latest sample of a source, false when no pass has seen it yet */
+	bool sourceSample(obs_weak_source_t *source, PerfSourceSample &sample) const;
+	/* Copy of a source's history over [from, to), returns the bucket length used in ms */
+	qint64 historySeries(obs_weak_source_t *source, qint64 from, qint64 to, int count, QList<HistoryBucket> &points) const;
+
 	double targetFrameTime() const { return frameTime; }
 
 	QList<int> getDefaultHiddenColumns();
+
+	/* Numeric columns show the change against the baseline, nullptr shows the values */
+	void setBaseline(std::shared_ptr<const PerfBaseline> b);
+	std::shared_ptr<const PerfBaseline> getBaseline() const { return baseline; }
+	/* Rows and shares only compare against a baseline captured with the same show mode and attribution */
+	bool baselineMatches(const PerfBaseline &b) const;
+	/* Numeric values of every row in the tree */
+	PerfBaseline captureBaseline(const QString &name) const;
+	/* Change of a numeric column against the baseline, false when the row or column is not in it */
+	bool baselineDelta(int column, const PerfTreeItem *item, double &delta) const;
+	/* Compares two rows like the column does, by the change against the baseline when comparing */
+	int compare(int column, const PerfTreeItem *left, const PerfTreeItem *right) const;
+
+	/* Replaces the user defined columns, they follow the built-in ones */
+	void setExpressionColumns(const QList<ExpressionColumn> &expressions);
+	/* Sources rendered more than once per frame, most wasted time first */
+	static QList<QStringList> redundantRenders();
+	/* Recorded frontend events, newest first */
+	QList<QStringList> markerRows() const;
 	void setGraphWidthFunc(std::function<int()> func) { graphWidthFunc = func; }
 
+	/* Pinned sources are sampled on every pass, all rows of the source follow */
+	void setPinned(const PerfTreeItem *item, bool pin);
+	QStringList getPinnedSources() const;
+	void setPinnedSources(const QStringList &uuids);
+	/* Rows below a collapsed parent count as not visible to the scheduler */
+	void setExpanded(const QModelIndex &index, bool expanded);
+
+signals:
+	/* Emitted after every sampling pass */
+	void updated();
+
 public slots:
 	void refreshSources();
 
@@ -111,6 +370,7 @@ private slots:
 private:
 	PerfTreeItem *rootItem = nullptr;
 	QList<PerfTreeColumn> columns;
+	qsizetype builtinColumns = 0;
 	std::unique_ptr<QThread> updater;
 	bool updaterRunning;
 	std::function<int()> graphWidthFunc = nullptr;
@@ -120,6 +380,64 @@ private:
 	bool refreshing = false;
 	double frameTime = 0.0;
 	unsigned int refreshInterval = 1000;
+	enum SharedAttribution sharedAttribution = SHARED_FULL;
+	enum HotspotMetric hotspotMetric = HOTSPOT_TOTAL;
+	int hotspotCount = 20;
+	bool showPipeline = false;
+	qint64 graphSpan = 0;
+	std::shared_ptr<const PerfBaseline> baseline;
+	/* Expressions of the expression columns, replaced on the UI thread and taken by the updater once per pass */
+	std::shared_ptr<const PerfExpressionSet> expressionSet;
+	std::shared_ptr<const PerfExpressionSet> passExpressions;
+	/* Changed with the baseline so the cells are formatted again */
+	uint64_t baselineGeneration = 0;
+	/* Pinned source UUIDs, read when rows are created */
+	QSet<QString> pinned;
+	mutable QMutex pinnedMutex;
+	/* Guards PerfTreeItem::search_published, held by the proxy while filtering */
+	mutable QMutex searchMutex;
+
+	/* Latest result per source, written by the updater and read from the UI under samplesMutex. The tree rows, history,
+	   frame budget, lag tracker and advisor all read these, so each source is asked for its result once per pass at most. */
+	QHash<obs_weak_source_t *, PerfSourceSample> samples;
+	mutable QMutex samplesMutex;
+	uint64_t samplePass = 0;
+
+	/* Cost per source over the whole session, written by the updater and read from the UI under historyMutex */
+	QHash<obs_weak_source_t *, PerfHistory *> history;
+	mutable QMutex historyMutex;
+	/* Time of the last history sample in ms */
+	qint64 historyTime = 0;
+
+	/* Operator action recorded from a frontend event */
+	struct Marker {
+		qint64 time;
+		const char *label;
+		QString detail;
+	};
+	QList<Marker> markers;
+	/* Markers not drawn yet, set on the UI thread and taken by the next pass */
+	std::atomic<int> pendingMarkers{0};
+	bool markerPass = false;
+	void addMarker(const char *label, const QString &detail = QString());
+	void recordMarker(enum obs_frontend_event event);
+
+	/* libobs profiler stage over the last pass, in ns */
+	struct PipelineStage {
+		uint64_t avg = 0;
+		uint64_t max = 0;
+		/* Time spent per frame interval */
+		uint64_t sum = 0;
+		uint64_t p50 = 0;
+		uint64_t p95 = 0;
+		uint64_t p99 = 0;
+	};
+	QHash<QString, PipelineStage> pipelineStages;
+	/* Cumulative call counts per duration from the previous snapshot, the profiler only keeps totals */
+	QHash<QString, QHash<uint64_t, uint64_t>> pipelineCounts;
+	uint64_t pipelineTime = 0;
+	/* The last snapshot had stages not seen before */
+	bool pipelineAdded = false;
 
 	static bool EnumAll(void *data, obs_source_t *source);
 	static bool EnumNotPrivateSource(void *data, obs_source_t *source);
@@ -128,7 +446,12 @@ private:
 	static bool EnumFilterSource(void *data, obs_source_t *source);
 	static bool EnumTransition(void *data, obs_source_t *source);
 	static bool EnumAllSource(void *data, obs_source_t *source);
+	static bool EnumHotspot(void *data, obs_source_t *source);
+	static bool EnumSourceType(void *data, obs_source_t *source);
 	static bool EnumSceneItem(obs_scene_t *, obs_sceneitem_t *item, void *data);
+	static bool EnumPipelineItem(void *data, profiler_snapshot_entry_t *entry);
+	static bool EnumPipelineStage(void *data, profiler_snapshot_entry_t *entry);
+	static bool EnumSample(void *data, obs_source_t *source);
 	static void EnumFilter(obs_source_t *, obs_source_t *child, void *data);
 	static void EnumTree(obs_source_t *, obs_source_t *child, void *data);
 	static bool ExistsChild(PerfTreeItem *parent, obs_source_t *source);
@@ -145,8 +468,26 @@ private:
 	void remove_sceneitem(obs_source_t *scene, obs_sceneitem_t *item, const QModelIndex &parent = QModelIndex());
 
 	void remove_siblings(const QModelIndex &parent = QModelIndex());
+	void remove_empty_group(const QModelIndex &index);
+
+	void updateCells(PerfTreeItem *item) const;
+	void updateHotspots();
+	void updateShares();
+	PerfTreeItem *typeGroup(obs_source_t *source, bool notify);
+	void addPipeline();
+	void updatePipeline();
+	void updateSamples();
+	void refreshSample(obs_source_t *source, PerfSourceSample &sample);
+	/* Sample for a row on the updater thread, refreshed when the row is pinned or the source is new */
+	PerfSourceSample rowSample(obs_source_t *source, obs_weak_source_t *weak, bool pin);
+	void publishSearchIndex(PerfTreeItem *item);
+	void captureItem(const PerfTreeItem *item, PerfBaseline &b) const;
+	void dropMismatchedBaseline();
+	/* Returns whether a row below item is pinned */
+	bool applyPinned(PerfTreeItem *item);
 
 	friend class PerfTreeItem;
+	friend class PerfViewerProxyModel;
 };
 
 class PerfTreeItem {
@@ -170,6 +511,18 @@ public:
 	void update();
 	QIcon getIcon(obs_source_t *source) const;
 	obs_source_t *getSource() const { return obs_weak_source_get_source(m_source); }
+	obs_weak_source_t *weakSource() const { return m_source; }
+	obs_sceneitem_t *sceneItem() const { return m_sceneitem; }
+	/* Aggregated result of the last pass */
+	const profiler_result_t *result() const { return m_perf; }
+	/* Variables of the last pass for expression columns */
+	void expressionInput(ExpressionInput &input) const;
+	/* Expression column values of the last pass that evaluated them, may be null */
+	std::shared_ptr<const PerfExpressionValues> expressionValues() const { return std::atomic_load(&expression_values); }
+	/* Identity in a baseline: the UUIDs and scene item ids of the row and its parents, or the type or pipeline
+	   stage of group rows. Built on first use from the UI thread. */
+	const QString &baselineKey() const;
+	bool isPinned() const { return pinned; }
 
 private:
 	QList<PerfTreeItem *> m_childItems;
@@ -179,6 +532,7 @@ private:
 	profiler_result_t *m_perf = nullptr;
 	obs_weak_source_t *m_source = nullptr;
 	obs_sceneitem_t *m_sceneitem = nullptr;
+	QString uuid;
 	QString name;
 	QString sourceDisplayName;
 	QString sourceType;
@@ -188,10 +542,81 @@ private:
 	bool enabled = false;
 	bool is_private = false;
 	bool is_filter = false;
+	/* Source type group, sums all of its instances */
+	bool is_rollup = false;
+	QString rollupId;
+	/* Stage of the libobs profiler, identified by the names of its parent stages */
+	bool is_pipeline = false;
+	QString pipelinePath;
+	mutable QString baseline_key;
+	uint64_t p50 = 0;
+	uint64_t p95 = 0;
+	uint64_t p99 = 0;
+	/* Async pipeline health, derived from the async input and output statistics */
+	double async_dropped = 0.0;
+	double async_jitter = 0.0;
+	double async_peak_input = 0.0;
+	int async_underrun_streak = 0;
+	uint64_t async_underruns = 0;
+	bool async_wasteful = false;
+	double async_health = 100.0;
+	/* Render passes per frame, render_sum / render_avg */
+	double renders_per_frame = 0.0;
+	/* Cost of the render passes after the first, from the same result as renders_per_frame */
+	uint64_t redundant_render = 0;
+	/* Part of this subtree's tick attributed to the parent row */
+	double share = 1.0;
+	bool shared = false;
 	int child_count = 0;
 	QIcon icon;
+	uint32_t width = 0;
+	uint32_t height = 0;
 	QImage graph;
 	int prev_graph_value = 0;
+	/* Graph was last drawn from the history instead of scrolled */
+	bool history_graph = false;
+
+	/* Rows are updated in the passes that refreshed their source's sample */
+	std::atomic<bool> pinned{false};
+	/* A row below is pinned, stays set after that row is removed until the pins are applied again */
+	std::atomic<bool> pinned_below{false};
+	/* Set from the view on the UI thread */
+	std::atomic<bool> expanded{false};
+	bool sampled = false;
+	/* Left out as inactive and not shown, updated right away once shown */
+	bool hidden = false;
+	/* Passes left out since the last update */
+	int skipped_passes = 0;
+
+	/* Formatted text and colors, rebuilt on the UI thread once per changed tick */
+	std::atomic<uint64_t> generation{1};
+	uint64_t cells_generation = 0;
+	double cells_frame_time = 0.0;
+	uint64_t cells_baseline = 0;
+	QList<PerfTreeCell> cells;
+	/* Replaced by the updater when the columns change and read from the UI with std::atomic_load, the values
+	   follow generation like the other fields */
+	std::shared_ptr<PerfExpressionValues> expression_values;
+
+	/* Search index */
+	QString searchName;
+	QString searchType;
+	QString searchScene;
+	/* Built by the updater, copied to search_published at the end of the pass */
+	PerfSearchIndex search_index;
+	/* Read by the proxy under the model's searchMutex */
+	PerfSearchIndex search_published;
+	uint64_t search_generation = 0;
+	bool search_result = false;
+
+	uint32_t searchFlags() const;
+	void updateSearchIndex();
+	void updateAsyncHealth();
+	/* Returns whether a value changed */
+	bool updateExpressions();
+	void drawHistory(int width);
+	bool sampleDue();
+	bool visible() const;
 
 	static void filter_add(void *, calldata_t *);
 	static void filter_remove(void *, calldata_t *);
@@ -200,6 +625,8 @@ private:
 	static void sceneitem_visible(void *, calldata_t *);
 
 	friend class PerfTreeModel;
+	friend class PerfSearch;
+	friend class PerfViewerProxyModel;
 };
 
 class PerfViewerProxyModel : public QSortFilterProxyModel {
@@ -208,15 +635,45 @@ class PerfViewerProxyModel : public QSortFilterProxyModel {
 public:
 	PerfViewerProxyModel(QObject *parent = nullptr) : QSortFilterProxyModel(parent)
 	{
-		setRecursiveFilteringEnabled(true);
+		// Parents of matches are accepted through the subtree summaries in accepts()
+		setRecursiveFilteringEnabled(false);
 		setSortRole(Qt::UserRole);
+		// This also turns off dynamic filtering. Both are done once per pass in dataUpdated instead of on every
+		// dataChanged: re-sorting when a row crossed a neighbor, re-filtering when the search reads values that
+		// change or rows were inserted.
+		setDynamicSortFilter(false);
+		lastRank.start();
 	}
 
+	/* Minimum time between re-ranks in ms, 0 re-ranks on every update */
+	void setRankInterval(int interval) { rankInterval = interval; }
+	int getRankInterval() const { return rankInterval; }
+	/* Relative difference needed before two neighbors swap places */
+	void setRankHysteresis(double hysteresis) { rankHysteresis = hysteresis; }
+	double getRankHysteresis() const { return rankHysteresis; }
+
 public slots:
 	void setFilterText(const QString &filter);
+	void dataUpdated();
+	void rowsAdded();
 
 protected:
 	bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+	bool lessThan(const QModelIndex &left, const QModelIndex &right) const override;
+
+private:
+	int rankInterval = 0;
+	double rankHysteresis = 0.0;
+	QElapsedTimer lastRank;
+	PerfSearch search;
+	uint64_t searchGeneration = 1;
+	/* Rows were inserted since the last filter pass, a cached parent may hide a new match */
+	bool rowsChanged = false;
+
+	/* Whether any row below parent moved past a neighbor by more than the hysteresis. This walks every
+	   proxy row until the first crossing, it only decides whether dataUpdated can skip the full sort. */
+	bool crossedNeighbor(const QModelIndex &parent) const;
+	bool accepts(PerfTreeItem *item) const;
 };
 
 class QuickThread : public QThread {